@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec3 aOffset;
+
+// must match terrain.vert bit for bit, the main pass tests against this depth with GL_EQUAL
+invariant gl_Position;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos + aOffset, 1.0);
+}
\ No newline at end of file
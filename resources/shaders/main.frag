@@ -5,7 +5,6 @@ in VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec2 TexCoords;
-    vec4 FragPosLightSpace;
 } fs_in;
 
 struct Material {
@@ -21,49 +20,74 @@ struct Light {
     vec3 specular;
 };
 
-uniform sampler2D shadowMap;
+uniform sampler2DArrayShadow shadowMap;
+uniform int shadowKernel;   // 0 = single tap, 1 = 2x2 grid, 2 = rotated Poisson disk
+uniform float shadowRadius; // Poisson disk radius in texels
+uniform mat4 lightSpaceMatrices[4];
+uniform float cascadeSplits[4];
+uniform int cascadeCount;
+uniform mat4 view;
 uniform vec3 viewPos;
 uniform Material material;
 uniform Light light;
 
-float ShadowCalculation(vec4 fragPosLightSpace) {
-    // perform perspective divide
-    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-    // transform to [0,1] range
-    projCoords = projCoords * 0.5 + 0.5;
-    // get closest depth value from light's perspective (using [0,1] range fragPosLight as coords)
-    float closestDepth = texture(shadowMap, projCoords.xy).r;
-    // get depth of current fragment from light's perspective
-    float currentDepth = projCoords.z;
-    // calculate bias (based on depth map resolution and slope)
-    vec3 normal = normalize(fs_in.Normal);
-    vec3 lightDir = normalize(light.position - fs_in.FragPos);
-    float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
-    // check whether current frag pos is in shadow
-    // float shadow = currentDepth - bias > closestDepth  ? 1.0 : 0.0;
-    // PCF
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-    for (int x = -1; x <= 1; ++x)
-    {
-        for (int y = -1; y <= 1; ++y)
-        {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
-            shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;
+const vec2 poissonDisk[8] = vec2[](
+    vec2(-0.326212, -0.405810), vec2(-0.840144, -0.073580), vec2(-0.695914, 0.457137), vec2(-0.203345, 0.620716),
+    vec2(0.962340, -0.194983), vec2(0.473434, -0.480026), vec2(0.519456, 0.767022), vec2(0.185461, -0.893124)
+);
+
+float ShadowCalculation(vec3 fragPos, vec3 normal, vec3 lightDir) {
+    // pick the first cascade whose far split lies beyond this fragment
+    float depthValue = abs((view * vec4(fragPos, 1.0)).z);
+    int layer = cascadeCount - 1;
+    for (int i = 0; i < cascadeCount; ++i) {
+        if (depthValue < cascadeSplits[i]) {
+            layer = i;
+            break;
         }
     }
-    shadow /= 9.0;
 
+    vec4 fragPosLightSpace = lightSpaceMatrices[layer] * vec4(fragPos, 1.0);
+    // perform perspective divide and transform to [0,1] range
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
     // keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
     if (projCoords.z > 1.0)
-    shadow = 0.0;
+        return 0.0;
+
+    float currentDepth = projCoords.z;
+    // calculate bias (based on depth map resolution and slope), smaller for the tighter near cascades
+    float bias = max(0.002 * (1.0 - dot(normal, lightDir)), 0.0005) * (layer + 1);
+    // hardware PCF: every tap is a depth comparison filtered over 2x2 texels
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+    float reference = currentDepth - bias;
+    float lit = 0.0;
+    if (shadowKernel == 0) {
+        lit = texture(shadowMap, vec4(projCoords.xy, layer, reference));
+    } else if (shadowKernel == 1) {
+        // four filtered taps half a texel apart cover the same 3x3 texels as nine point taps
+        for (int x = 0; x < 2; ++x)
+            for (int y = 0; y < 2; ++y)
+                lit += texture(shadowMap, vec4(projCoords.xy + (vec2(x, y) - 0.5) * texelSize, layer, reference));
+        lit /= 4.0;
+    } else {
+        // Poisson disk rotated per pixel, which trades banding for fine grain
+        float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+        mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+        for (int i = 0; i < 8; ++i) {
+            vec2 offset = rotation * poissonDisk[i] * shadowRadius * texelSize;
+            lit += texture(shadowMap, vec4(projCoords.xy + offset, layer, reference));
+        }
+        lit /= 8.0;
+    }
 
-    return shadow;
+    return 1.0 - lit;
 }
 
 void main()
 {
-    vec3 color = texture(material.diffuse, fs_in.TexCoords).rgb;
+    // sRGB texture, decoded for the linear scene target
+    vec3 color = pow(texture(material.diffuse, fs_in.TexCoords).rgb, vec3(2.2));
     vec3 normal = normalize(fs_in.Normal);
 
     // ambient
@@ -72,7 +96,7 @@ void main()
     // diffuse
     vec3 lightDir = normalize(light.position - fs_in.FragPos);
     float diff = max(dot(lightDir, normal), 0.0);
-    vec3 diffuse = diff * light.diffuse *  texture(material.diffuse, fs_in.TexCoords).rgb;
+    vec3 diffuse = diff * light.diffuse * color;
 
     // specular
     vec3 viewDir = normalize(viewPos - fs_in.FragPos);
@@ -83,8 +107,8 @@ void main()
     vec3 specular = spec * light.specular;
 
     // calculate shadow
-    float shadow = ShadowCalculation(fs_in.FragPosLightSpace);
-    vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;
+    float shadow = ShadowCalculation(fs_in.FragPos, normal, lightDir);
+    vec3 lighting = ambient + (1.0 - shadow) * (diffuse + specular);
 
     FragColor = vec4(lighting, 1.0);
 }
\ No newline at end of file
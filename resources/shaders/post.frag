@@ -0,0 +1,73 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D scene;
+// fraction of the target that was rendered to, and the last texel center inside it
+uniform vec2 uvScale;
+uniform vec2 uvMax;
+uniform vec2 texelSize;
+uniform float exposure;
+uniform bool fxaa;
+
+// FXAA tuning, the values of the reference PC implementation
+const float EDGE_THRESHOLD = 0.125;
+const float EDGE_THRESHOLD_MIN = 0.0312;
+const float REDUCE_MUL = 1.0 / 8.0;
+const float REDUCE_MIN = 1.0 / 128.0;
+const float SPAN_MAX = 8.0;
+
+// Narkowicz's fit of the ACES filmic curve, then gamma encoding
+vec3 toneMap(vec3 color)
+{
+    color *= exposure;
+    color = clamp((color * (2.51 * color + 0.03)) / (color * (2.43 * color + 0.59) + 0.14), 0.0, 1.0);
+    return pow(color, vec3(1.0 / 2.2));
+}
+
+// every tap is tone mapped first, so edges are found and blended in display space
+vec3 tap(vec2 uv)
+{
+    return toneMap(texture(scene, min(uv, uvMax)).rgb);
+}
+
+float luma(vec3 color)
+{
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+void main()
+{
+    vec2 uv = min(TexCoords * uvScale, uvMax);
+    vec3 center = tap(uv);
+    if (!fxaa) {
+        FragColor = vec4(center, 1.0);
+        return;
+    }
+
+    float lumaM = luma(center);
+    float lumaNW = luma(tap(uv + vec2(-1.0, -1.0) * texelSize));
+    float lumaNE = luma(tap(uv + vec2(1.0, -1.0) * texelSize));
+    float lumaSW = luma(tap(uv + vec2(-1.0, 1.0) * texelSize));
+    float lumaSE = luma(tap(uv + vec2(1.0, 1.0) * texelSize));
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    // flat areas, most of the screen, stop here
+    if (lumaMax - lumaMin < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD)) {
+        FragColor = vec4(center, 1.0);
+        return;
+    }
+
+    // blur along the edge, longer for flatter gradients
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * REDUCE_MUL, REDUCE_MIN);
+    float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+    dir = clamp(dir * rcpDirMin, -SPAN_MAX, SPAN_MAX) * texelSize;
+
+    vec3 rgbA = 0.5 * (tap(uv + dir * (1.0 / 3.0 - 0.5)) + tap(uv + dir * (2.0 / 3.0 - 0.5)));
+    vec3 rgbB = rgbA * 0.5 + 0.25 * (tap(uv - dir * 0.5) + tap(uv + dir * 0.5));
+    // the wider blur crossed another edge, fall back to the narrow one
+    float lumaB = luma(rgbB);
+    FragColor = vec4(lumaB < lumaMin || lumaB > lumaMax ? rgbA : rgbB, 1.0);
+}
\ No newline at end of file
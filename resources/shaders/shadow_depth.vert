@@ -1,10 +1,13 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aInstanceModel;
 
 uniform mat4 lightSpaceMatrix;
 uniform mat4 model;
+uniform bool instanced;
 
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+    mat4 world = instanced ? model * aInstanceModel : model;
+    gl_Position = lightSpaceMatrix * world * vec4(aPos, 1.0);
 }
\ No newline at end of file
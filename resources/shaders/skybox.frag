@@ -7,5 +7,6 @@ uniform samplerCube skybox;
 
 void main()
 {
-    FragColor = texture(skybox, TexCoords);
+    // sRGB faces, decoded for the linear scene target
+    FragColor = vec4(pow(texture(skybox, TexCoords).rgb, vec3(2.2)), 1.0);
 }
\ No newline at end of file
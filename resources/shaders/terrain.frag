@@ -1,15 +1,86 @@
 #version 330 core
 flat in vec3 flatColor;
 in vec3 Color;
+in vec3 WorldPos;
+in vec3 WorldNormal;
 
 out vec4 FragColor;
 
+struct Light {
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
 uniform bool isFlat;
+uniform Light light;
+uniform float shadowStrength;
+uniform sampler2DArrayShadow shadowMap;
+uniform int shadowKernel;   // 0 = single tap, 1 = 2x2 grid, 2 = rotated Poisson disk
+uniform float shadowRadius; // Poisson disk radius in texels
+uniform mat4 lightSpaceMatrices[4];
+uniform float cascadeSplits[4];
+uniform int cascadeCount;
+uniform mat4 view;
 
-void main() {
-    if (isFlat) {
-        FragColor = vec4(flatColor, 1.0);
+const vec2 poissonDisk[8] = vec2[](
+    vec2(-0.326212, -0.405810), vec2(-0.840144, -0.073580), vec2(-0.695914, 0.457137), vec2(-0.203345, 0.620716),
+    vec2(0.962340, -0.194983), vec2(0.473434, -0.480026), vec2(0.519456, 0.767022), vec2(0.185461, -0.893124)
+);
+
+float ShadowCalculation(vec3 fragPos, vec3 normal, vec3 lightDir) {
+    // pick the first cascade whose far split lies beyond this fragment
+    float depthValue = abs((view * vec4(fragPos, 1.0)).z);
+    int layer = cascadeCount - 1;
+    for (int i = 0; i < cascadeCount; ++i) {
+        if (depthValue < cascadeSplits[i]) {
+            layer = i;
+            break;
+        }
+    }
+
+    vec4 fragPosLightSpace = lightSpaceMatrices[layer] * vec4(fragPos, 1.0);
+    // perform perspective divide and transform to [0,1] range
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+    // keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
+    if (projCoords.z > 1.0)
+        return 0.0;
+
+    float currentDepth = projCoords.z;
+    // calculate bias (based on depth map resolution and slope), smaller for the tighter near cascades
+    float bias = max(0.002 * (1.0 - dot(normal, lightDir)), 0.0005) * (layer + 1);
+    // hardware PCF: every tap is a depth comparison filtered over 2x2 texels
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+    float reference = currentDepth - bias;
+    float lit = 0.0;
+    if (shadowKernel == 0) {
+        lit = texture(shadowMap, vec4(projCoords.xy, layer, reference));
+    } else if (shadowKernel == 1) {
+        // four filtered taps half a texel apart cover the same 3x3 texels as nine point taps
+        for (int x = 0; x < 2; ++x)
+            for (int y = 0; y < 2; ++y)
+                lit += texture(shadowMap, vec4(projCoords.xy + (vec2(x, y) - 0.5) * texelSize, layer, reference));
+        lit /= 4.0;
     } else {
-        FragColor = vec4(Color, 1.0);
+        // Poisson disk rotated per pixel, which trades banding for fine grain
+        float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+        mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+        for (int i = 0; i < 8; ++i) {
+            vec2 offset = rotation * poissonDisk[i] * shadowRadius * texelSize;
+            lit += texture(shadowMap, vec4(projCoords.xy + offset, layer, reference));
+        }
+        lit /= 8.0;
     }
+
+    return 1.0 - lit;
+}
+
+void main() {
+    // already linear and lit, see terrain.vert
+    vec3 color = isFlat ? flatColor : Color;
+    // the reduced-resolution water passes turn shadows off
+    float shadow = shadowStrength > 0.0 ? ShadowCalculation(WorldPos, normalize(WorldNormal), normalize(-light.direction)) : 0.0;
+    FragColor = vec4(color * (1.0 - shadowStrength * shadow), 1.0);
 }
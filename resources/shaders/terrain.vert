@@ -4,8 +4,13 @@ layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec3 aColor;
 layout (location = 3) in vec3 aOffset;
 
+// written exactly as in depth_prepass.vert
+invariant gl_Position;
+
 flat out vec3 flatColor;
 out vec3 Color;
+out vec3 WorldPos;
+out vec3 WorldNormal;
 
 struct Light {
     vec3 direction;
@@ -20,6 +25,8 @@ uniform vec3 viewPos;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+// only takes effect while GL_CLIP_DISTANCE0 is enabled, i.e. in the water reflection passes
+uniform vec4 clipPlane;
 
 vec3 calculateLighting(vec3 Normal, vec3 FragPos) {
     // Ambient lighting
@@ -48,8 +55,12 @@ void main() {
     //    vec3 Normal = transpose(inverse(mat3(u_model))) * aNormal;
 
     vec3 lighting = calculateLighting(Normal, FragPos);
-    Color = aColor * lighting;
+    // the palette is authored in sRGB; linearize it before lighting, which works in linear space
+    Color = pow(aColor, vec3(2.2)) * lighting;
     flatColor = Color;
+    WorldPos = FragPos;
+    WorldNormal = normalize(Normal);
+    gl_ClipDistance[0] = dot(vec4(FragPos, 1.0), clipPlane);
 
     gl_Position = projection * view * model * vec4(aPos + aOffset, 1.0);
 }
@@ -1,27 +1,31 @@
 #version 330 core
 out vec4 FragColor;
 
+in vec3 FragPos;
 in vec3 vertexPos;
 in vec2 TexCoord;
+in vec2 OceanCoord;
+in vec4 ClipPos;
 
 uniform sampler2D TexWater;
+uniform sampler2D normalMap;
 //uniform samplerCube skybox;
-uniform vec3 cameraPos;
+uniform vec3 viewPos;
+
+// planar reflection/refraction, rendered at reduced resolution from the same viewpoint
+uniform bool reflections;
+uniform sampler2D reflectionMap;
+uniform sampler2D refractionMap;
+uniform float distortion;
 
 void main()
 {
-    FragColor = vec4(60/ 255.0, 95 / 255.0, 190 / 255.0, 1.0f);
-
-    vec3 Normals = normalize(cross(dFdx(vertexPos), dFdy(vertexPos)));
+    FragColor = vec4(pow(vec3(60/ 255.0, 95 / 255.0, 190 / 255.0), vec3(2.2)), 1.0f);
 
-    float ratio = 1.00 / 1.33;
-    vec3 I = normalize(vertexPos - cameraPos);
-    vec3 refraction = refract(I, normalize(-Normals), ratio);
-
-    vec3 reflection = reflect(I, normalize(-Normals));
+    vec3 Normals = normalize(texture(normalMap, OceanCoord).xyz);
 
     vec3 diffuse = vec3(-1.0, -1.0, -1.0);
-    float attenuation =  dot(-normalize(cross(dFdx(vertexPos), dFdy(vertexPos))), diffuse);
+    float attenuation =  dot(Normals, -diffuse);
     attenuation = max(attenuation, 0.0);
 
     vec3 hazy_ambiant = 0.4 * vec3(0.741, 0.745, 0.752);
@@ -30,4 +34,18 @@ void main()
     FragColor.xyz *= (hazy_ambiant + attenuation);
     FragColor.a = 0.7;
 
+    if (reflections) {
+        // both maps line up with the screen; the waves bend the lookup a little
+        vec2 screen = ClipPos.xy / ClipPos.w * 0.5 + 0.5;
+        vec2 uv = clamp(screen + Normals.xz * distortion, 0.001, 0.999);
+        vec3 reflected = texture(reflectionMap, uv).rgb;
+        vec3 refracted = mix(texture(refractionMap, uv).rgb, FragColor.rgb, FragColor.a);
+
+        // Schlick's approximation with water's reflectance at normal incidence
+        float cosine = max(dot(normalize(viewPos - FragPos), Normals), 0.0);
+        float fresnel = 0.02 + 0.98 * pow(1.0 - cosine, 5.0);
+        // the refraction map already holds what's under the surface, so nothing needs blending
+        FragColor = vec4(mix(refracted, reflected, fresnel), 1.0);
+    }
+
 }
\ No newline at end of file
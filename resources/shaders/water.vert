@@ -4,27 +4,27 @@ layout (location = 1) in vec2 aTexCoord;
 
 out vec3 FragPos;
 out vec2 TexCoord;
+out vec2 OceanCoord;
 out vec3 vertexPos;
+out vec4 ClipPos;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
-uniform float time;
 
-uniform float speed;
-uniform float amount;
-uniform float height;
+// x offset, height and z offset from the FFT ocean, tiled every patchSize units
+uniform sampler2D displacementMap;
+uniform float patchSize;
 
 void main()
 {
-    vertexPos = aPos;
+    OceanCoord = aPos.xz / patchSize;
+    vec3 displacement = textureLod(displacementMap, OceanCoord, 0.0).xyz;
+    vertexPos = vec3(aPos.x + displacement.x, displacement.y, aPos.z + displacement.z);
 
-    float xx = (aPos.x-3) * (aPos.x-3);
-    float yy = (aPos.y+1) * (aPos.y+1);
-
-    float y = sin(time * speed + (aPos.x * aPos.z * amount) + 0.5 * cos(aPos.x * aPos.z * amount)) * height;
-    FragPos = vec3(model * vec4(aPos.x, y, aPos.z, 1.0f));
+    FragPos = vec3(model * vec4(vertexPos, 1.0f));
     gl_Position = projection * view * vec4(FragPos, 1.0f);
+    ClipPos = gl_Position;
 
     TexCoord = vec2(aTexCoord.x, aTexCoord.y);
 }
\ No newline at end of file
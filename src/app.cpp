@@ -2,23 +2,86 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <random>
+#include <thread>
 
 #include "stb_image.h"
 #include "shader.h"
 #include "camera.h"
 #include "map_generator.h"
 #include "utils.h"
+#include "texture_cache.h"
+#include "cubemap_cache.h"
+#include "gl_resources.h"
+#include "geometry_arena.h"
+#include "mesh_file.h"
+#include "vertex_cache.h"
+#include "render_queue.h"
+#include "instancing.h"
+#include "shadow_cascades.h"
+#include "profiler.h"
+#include "headless.h"
+#include "frame_pacing.h"
+#include "dynamic_resolution.h"
 #include "water.h"
+#include "ocean.h"
+#include "water_reflections.h"
 
 const unsigned int SCR_WIDTH = 1200;
 const unsigned int SCR_HEIGHT = 900;
-const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
+// 4 x 512^2 cascades hold as many texels as the old single 1024^2 map
+const int SHADOW_CASCADES = 4;
+const int SHADOW_CASCADE_RESOLUTION = 512;
+const GLenum SHADOW_DEPTH_FORMAT = GL_DEPTH_COMPONENT16;
+const int SKYBOX_FACE_SIZE = 1024;
+// the water grid covers the terrain at rec_width spacing, independent of the terrain resolution
+const int WATER_GRID_SIZE = 400;
+const int OCEAN_MAX_THREADS = 3;
+const float WATER_LEVEL = -25.5f;
+const float EXPOSURE = 1.4f;
+// written as .csv and .json when P is pressed and on exit
+const char *PROFILE_PATH = "profile";
+const char *ANTI_ALIASING_NAMES[] = {"none", "fxaa", "msaa"};
+// the simulation always advances in steps of this size; rendering interpolates between the last two
+const double SIMULATION_STEP = 1.0 / 60.0;
+// frame rate of --pacing capped when no rate is given
+const double DEFAULT_FPS_CAP = 144.0;
+// GPU frame time dynamic resolution aims for unless --dynamic-resolution says otherwise
+const double DEFAULT_FRAME_TARGET_MS = 1000.0 / 60.0;
+const int BENCHMARK_WARMUP_FRAMES = 10;
+
+struct Options {
+    bool benchmark = false;
+    int frames = 600;
+    unsigned int seed = 1;
+    std::string output = "benchmark.json";
+    TerrainConfig terrain;
+    FramePacing pacing = PACING_VSYNC;
+    double fpsCap = DEFAULT_FPS_CAP;
+    // GPU frame time target in ms, 0 to render at full resolution, negative for the mode's default
+    double resolutionTargetMs = -1.0;
+    bool depthPrepass = true;
+    AntiAliasing antiAliasing = AA_FXAA;
+    OceanConfig ocean;
+    // resolution of the water reflection/refraction maps relative to the output, 0 turns them off
+    float reflectionScale = 0.5f;
+    // .mesh file (see mesh_converter) shown next to the props, none when empty
+    std::string model;
+};
+
+// Everything the fixed-step simulation owns. Rendering never reads it directly, only a blend of the
+// previous and current step.
+struct SimulationState {
+    double time = 0.0;
+    glm::vec3 lightPos = glm::vec3(-2.0f, 4.0f, -1.0f);
+};
 
-float opt_speed = 0.8f;
-float opt_amount = 0.01f;
-float opt_height = 0.5f;
 float rec_width = 0.5f;
 
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -28,15 +91,47 @@ float lastX = 800.0f / 2.0;
 float lastY = 600.0 / 2.0;
 
 float deltaTime = 0.0f;
-float lastFrame = 0.0f;
 
 GLFWwindow *window = nullptr;
+// benchmark mode without a window system; the scene is then drawn into headlessContext.framebuffer
+HeadlessContext headlessContext;
+bool headless = false;
+GLADloadproc glLoader = nullptr;
+unsigned int sceneFramebuffer = 0;
+int framebufferWidth = SCR_WIDTH, framebufferHeight = SCR_HEIGHT;
 
 glm::vec3 lightPos(-2.0f, 4.0f, -1.0f);
 
 unsigned int diffuseMap, specularMap, grassTexture, containerTexture, rockTexture;
 
-int initOpengl();
+// props drawn as instances of the cube mesh; index 0 is the light tracker, which moves every frame
+std::vector<glm::mat4> cubeTransforms;
+InstanceBuffer cubeInstances(INSTANCE_MATRIX);
+// one offset per terrain instance, fed to terrain.vert's aOffset
+std::vector<glm::vec3> terrainOffsets{glm::vec3(0.0f)};
+InstanceBuffer terrainInstances(INSTANCE_OFFSET);
+TerrainChunks terrainChunks;
+TerrainChunks terrainLodChunks;
+ShadowCascades shadowCascades(SHADOW_CASCADES, SHADOW_CASCADE_RESOLUTION, SHADOW_DEPTH_FORMAT);
+Profiler profiler;
+DynamicResolution dynamicResolution(DEFAULT_FRAME_TARGET_MS);
+// cascades whose static casters were redrawn, summed over all frames
+long long shadowStaticRedraws = 0;
+// static geometry, one arena per vertex layout; indices in each are relative to the mesh's base vertex
+// the terrain keeps its positions in a stream of their own for the shadow passes
+GeometryArena terrainArena({{0, 3}, {1, 3}, {2, 3}}, true); // position | normal, color
+GeometryArena litArena({{0, 3}, {1, 3}, {2, 2}});           // position, normal, texture coordinates: floor, cube
+GeometryArena texturedArena({{0, 3}, {1, 2}});              // position, texture coordinates: water, skybox, quad
+// meshes of --model, all drawn with modelTransform
+std::vector<GeometryRange> modelMeshes;
+glm::mat4 modelTransform(1.0f);
+double modelLoadMs = 0.0;
+
+bool parseOptions(int argc, char **argv, Options &options);
+
+int initOpengl(bool benchmark);
+
+int createWindow(bool hidden);
 
 void framebufferSizeCallback(GLFWwindow *, int width, int height);
 
@@ -46,32 +141,92 @@ void mouseCallback(GLFWwindow *window, double xpos, double ypos);
 
 void scrollCallback(GLFWwindow *window, double xoffset, double yoffset);
 
-void createSkybox(unsigned int &texture, unsigned int &VAO, unsigned int &VBO);
+int runScene(Options &options);
 
-void createFloor(unsigned int &VAO);
+void releaseGlResources();
 
-void renderScene(const Shader &shader, unsigned int &floorVAO, unsigned int &terrainVAO);
+GeometryRange createSkybox(GLTexture &texture);
 
-void renderCube();
+GeometryRange createFloor();
+
+void createProps();
+
+bool loadModel(const std::string &path);
+
+void updateProps();
+
+void getPropBounds(glm::vec3 &min, glm::vec3 &max);
+
+void submitScene(RenderQueue &queue, const Shader &shader, RenderPass pass, const GeometryRange &floor);
+
+void submitModel(RenderQueue &queue, const Shader &shader, RenderPass pass);
+
+const GeometryRange &getCube();
 
 void renderQuad();
 
-int main() {
-    if (initOpengl() != 0) {
+void stepSimulation(SimulationState &state, double step);
+
+SimulationState interpolateSimulation(const SimulationState &previous, const SimulationState &current, float alpha);
+
+void followBenchmarkPath(float time);
+
+void writeBenchmarkReport(const Options &options, std::vector<double> frameTimes, double averageScale);
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return -1;
+    }
+    if (options.benchmark) {
+        worldSeed = options.seed;
+        // one simulation step per frame and no waiting, so runs are reproducible and measure rendering only
+        options.pacing = PACING_UNCAPPED;
+    }
+    if (options.resolutionTargetMs < 0.0) {
+        // benchmarks compare full-resolution frames unless asked to do otherwise
+        options.resolutionTargetMs = options.benchmark ? 0.0 : DEFAULT_FRAME_TARGET_MS;
+    }
+    if (initOpengl(options.benchmark) != 0) {
         return -1;
     }
 
+    int result = runScene(options);
+
+    // every GL object has to be deleted while the context is still current; the headless context deletes
+    // its own framebuffer as it goes, so leaks are counted after it's gone
+    releaseGlResources();
+    if (headless)
+        headlessContext.destroy();
+    else
+        glfwTerminate();
+    glResources.reportLeaks(std::cout);
+
+    return result;
+}
+
+int runScene(Options &options) {
+    FramePacer pacer(options.pacing, options.fpsCap);
+    if (window != nullptr)
+        pacer.apply();
+    terrainChunks.init(glLoader);
+    terrainLodChunks.init(glLoader);
+    for (GeometryArena *arena : {&terrainArena, &litArena, &texturedArena})
+        arena->init();
+
 //    TEXTURES
-    containerTexture = loadTexture("../../resources/textures/container.jpg");
-    diffuseMap = loadTexture("../../resources/textures/container2.png");
-    specularMap = loadTexture("../../resources/textures/container2_specular.png");
-    grassTexture = loadTexture("../../resources/textures/grass.png");
-    rockTexture = loadTexture("../../resources/textures/mountains.jpg");
-    unsigned int waterTexture = loadTexture("../../resources/textures/water.png");
+    containerTexture = textureCache.acquire("../../resources/textures/container.jpg");
+    diffuseMap = textureCache.acquire("../../resources/textures/container2.png");
+    specularMap = textureCache.acquire("../../resources/textures/container2_specular.png");
+    grassTexture = textureCache.acquire("../../resources/textures/grass.png");
+    rockTexture = textureCache.acquire("../../resources/textures/mountains.jpg");
 
 //    FLOOR
-    unsigned int floorVAO;
-    createFloor(floorVAO);
+    GeometryRange floor = createFloor();
+
+    createProps();
+    if (!options.model.empty() && !loadModel(options.model))
+        return -1;
 
 //    LIGHT
     Shader lightShader("../../resources/shaders/light.vert", "../../resources/shaders/light.frag");
@@ -80,19 +235,31 @@ int main() {
     lightShader.setInt("material.specular", 1);
 
 //    TERRAIN
-    unsigned int terrainVAO;
-    generateMap(terrainVAO);
+    generateMap(options.terrain, terrainArena, terrainChunks, terrainLodChunks);
+    terrainInstances.setOffsets(terrainOffsets);
+    terrainInstances.attach(terrainArena.vao(), 3);
 
     Shader terrainShader(
             "../../resources/shaders/terrain.vert",
             "../../resources/shaders/terrain.frag"
     );
-    terrainShader.use();
-    terrainShader.setBool("isFlat", true);
-    terrainShader.setVec3("light.ambient", 0.3, 0.2, 0.2);
-    terrainShader.setVec3("light.diffuse", 0.3, 0.3, 0.3);
-    terrainShader.setVec3("light.specular", 1.0, 1.0, 1.0);
-    terrainShader.setVec3("light.direction", -0.2f, -1.0f, -0.3f);
+    // a second program for the water passes, so their views and clip planes never leak into the main pass
+    Shader reflectionTerrainShader(
+            "../../resources/shaders/terrain.vert",
+            "../../resources/shaders/terrain.frag"
+    );
+    for (Shader *program : {&terrainShader, &reflectionTerrainShader}) {
+        program->use();
+        program->setBool("isFlat", true);
+        program->setVec3("light.ambient", 0.3, 0.2, 0.2);
+        program->setVec3("light.diffuse", 0.3, 0.3, 0.3);
+        program->setVec3("light.specular", 1.0, 1.0, 1.0);
+        program->setVec3("light.direction", -0.2f, -1.0f, -0.3f);
+        program->setInt("shadowMap", 0);
+    }
+    terrainShader.setFloat("shadowStrength", 0.6f);
+    reflectionTerrainShader.use();
+    reflectionTerrainShader.setFloat("shadowStrength", 0.0f);
 
 //    WATER
     Water water;
@@ -100,22 +267,48 @@ int main() {
             "../../resources/shaders/water.vert",
             "../../resources/shaders/water.frag"
     );
-    auto waterVertices = water.initVertices(VERTEX_COUNT * 2, rec_width, -25.0f);
-    auto waterIndices = water.initIndices(VERTEX_COUNT * 2);
-    unsigned int waterVAO = water.createVAO(waterVertices, waterIndices);
+    auto waterVertices = water.initVertices(WATER_GRID_SIZE, rec_width, -25.0f);
+    auto waterIndices = water.initIndices(WATER_GRID_SIZE);
+    optimizeVertexCache(*waterIndices);
+    GeometryRange waterGeometry = water.upload(waterVertices, waterIndices, texturedArena);
 
     waterShader.use();
     waterShader.setInt("TexWater", 0);
+    waterShader.setInt("displacementMap", 1);
+    waterShader.setInt("normalMap", 2);
+    waterShader.setFloat("patchSize", options.ocean.patchSize);
+    waterShader.setInt("reflectionMap", 3);
+    waterShader.setInt("refractionMap", 4);
+    waterShader.setBool("reflections", options.reflectionScale > 0.0f);
+    waterShader.setFloat("distortion", 0.02f);
+
+    WaterReflections waterReflections(options.reflectionScale, WATER_LEVEL);
+    if (options.reflectionScale > 0.0f)
+        waterReflections.init();
+
+    // leave a core for the render thread
+    options.ocean.threads = std::max(1, std::min(OCEAN_MAX_THREADS, (int) std::thread::hardware_concurrency() - 1));
+    Ocean ocean(options.ocean, worldSeed);
+    ocean.synchronous = options.benchmark;
+    if (!ocean.init()) {
+        return -1;
+    }
 
     // SKYBOX
-    unsigned int skyboxTexture, skyboxVAO, skyboxVBO;
-    createSkybox(skyboxTexture, skyboxVAO, skyboxVBO);
+    GLTexture skyboxTexture;
+    GeometryRange skyboxGeometry = createSkybox(skyboxTexture);
     Shader skyboxShader(
             "../../resources/shaders/skybox.vert",
             "../../resources/shaders/skybox.frag"
     );
-    skyboxShader.use();
-    skyboxShader.setInt("skybox", 0);
+    Shader reflectionSkyboxShader(
+            "../../resources/shaders/skybox.vert",
+            "../../resources/shaders/skybox.frag"
+    );
+    for (Shader *program : {&skyboxShader, &reflectionSkyboxShader}) {
+        program->use();
+        program->setInt("skybox", 0);
+    }
 
 //    DEPTH MAP
     Shader shader(
@@ -126,27 +319,16 @@ int main() {
             "../../resources/shaders/shadow_depth.vert",
             "../../resources/shaders/shadow_depth.frag"
     );
+    Shader depthPrepassShader(
+            "../../resources/shaders/depth_prepass.vert",
+            "../../resources/shaders/shadow_depth.frag"
+    );
     Shader debugDepthQuad(
             "../../resources/shaders/debug.vert",
             "../../resources/shaders/debug.frag"
     );
 
-    unsigned int depthMapFBO;
-    glGenFramebuffers(1, &depthMapFBO);
-    unsigned int depthMap;
-    glGenTextures(1, &depthMap);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT,
-                 NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    shadowCascades.init();
 
     shader.use();
     shader.setInt("shadowMap", 0);
@@ -155,69 +337,116 @@ int main() {
     debugDepthQuad.use();
     debugDepthQuad.setInt("depthMap", 0);
 
+//    DYNAMIC RESOLUTION AND POST-PROCESSING
+    Shader postShader(
+            "../../resources/shaders/post.vert",
+            "../../resources/shaders/post.frag"
+    );
+    postShader.use();
+    postShader.setInt("scene", 0);
+    postShader.setFloat("exposure", EXPOSURE);
+    dynamicResolution.antiAliasing = options.antiAliasing;
+    dynamicResolution.init();
+    dynamicResolution.enabled = options.resolutionTargetMs > 0.0;
+    dynamicResolution.targetMs = options.resolutionTargetMs;
+    unsigned long frameGpuSample = 0;
+    double scaleSum = 0.0;
+
+    RenderQueue renderQueue;
+    int frameIndex = 0;
+    std::vector<double> frameTimes;
+    FixedTimestep timestep(SIMULATION_STEP);
+    SimulationState previousState, currentState;
+    pacer.tick();
+
 //    RENDER LOOP
-    while (!glfwWindowShouldClose(window)) {
+    while (options.benchmark ? frameIndex < options.frames : !glfwWindowShouldClose(window)) {
+        auto frameStart = std::chrono::steady_clock::now();
         // DELTA TIME
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        double elapsed = pacer.tick();
+        deltaTime = options.benchmark ? SIMULATION_STEP : elapsed;
+        profiler.beginFrame();
+        dynamicResolution.update(profiler.newestGpu("frame", frameGpuSample));
+        profiler.begin("frame");
+
+        // SIMULATION
+        profiler.begin("update");
+        int steps = options.benchmark ? 1 : timestep.advance(elapsed);
+        for (int i = 0; i < steps; i++) {
+            previousState = currentState;
+            stepSimulation(currentState, SIMULATION_STEP);
+        }
+        float alpha = options.benchmark ? 1.0f : (float) timestep.alpha();
+        SimulationState state = interpolateSimulation(previousState, currentState, alpha);
 
         // INPUT
-        processInput(window);
+        // the camera follows input every frame rather than every step, so looking around stays responsive
+        if (options.benchmark)
+            followBenchmarkPath(state.time);
+        else
+            processInput(window);
 
-        generateMap(terrainVAO);
-
-        lightPos.z = sin(glfwGetTime() * 0.5) * 3.0;
+        lightPos = state.lightPos;
+        updateProps();
+        ocean.update(state.time);
+        profiler.end();
 
         // RENDER
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        profiler.begin("submit");
+        float cameraNear = 0.1f, cameraFar = 100.0f;
+        // the aspect ratio is the output's; the scaled target keeps it up to rounding
+        float aspect = (float) framebufferWidth / (float) framebufferHeight;
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), aspect, cameraNear, cameraFar);
+        glm::mat4 view = camera.GetViewMatrix();
+
+        glm::mat4 terrainModel = glm::mat4(1.0f);
+        terrainModel = glm::translate(terrainModel, glm::vec3(
+                -options.terrain.size / 2.0,
+                -30.0,
+                -options.terrain.size / 2.0
+                               )
+        );
+
 //        DEPTH TEST
-        glm::mat4 lightProjection, lightView;
-        glm::mat4 lightSpaceMatrix;
-        float near_plane = 1.0f, far_plane = 7.5f;
-        lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
-        lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
-        lightSpaceMatrix = lightProjection * lightView;
-        simpleDepthShader.use();
-        simpleDepthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, containerTexture);
-        renderScene(simpleDepthShader, floorVAO, terrainVAO);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // reset viewport
-        glViewport(0, 0, SCR_WIDTH * 2, SCR_HEIGHT * 2);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // the light sits at lightPos and looks at the origin, so treat it as directional for the cascades
+        glm::vec3 lightDir = glm::normalize(-lightPos);
+        shadowCascades.update(view, glm::radians(camera.Zoom), aspect, cameraNear, cameraFar, lightDir,
+                              terrainChunks.version);
+
+        renderQueue.clear();
+        renderQueue.setCamera(lightPos, shadowCascades.casterDistance);
+        submitScene(renderQueue, simpleDepthShader, PASS_SHADOW, floor);
+
+        // coarse, position-only terrain; chunks are culled per cascade right before it's drawn
+        DrawPacket terrainCaster;
+        terrainCaster.pass = PASS_SHADOW;
+        terrainCaster.shader = &simpleDepthShader;
+        terrainCaster.vao = terrainArena.positionVao();
+        terrainCaster.model = terrainModel;
+        terrainCaster.uniforms = [](const Shader &shader) { shader.setBool("instanced", false); };
+        terrainCaster.draw = [](const DrawPacket &packet) { terrainLodChunks.draw(packet.mode, 1); };
+        renderQueue.submit(terrainCaster);
 
         shader.use();
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f,
-                                                100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
         shader.setMat4("projection", projection);
         shader.setMat4("view", view);
         shader.setVec3("viewPos", camera.Position);
         shader.setVec3("light.position", lightPos);
-        shader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
         shader.setVec3("light.ambient", 0.0f, 0.0f, 0.0f);
         shader.setVec3("light.diffuse", 1.0f, 1.0f, 1.0f);
         shader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, depthMap);
+        shadowCascades.apply(shader);
 
-//        renderScene(shader, floorVAO, terrainVAO);
+//        submitScene(renderQueue, shader, PASS_OPAQUE, floor);
 //
 ////        DEBUG
 ////        debugDepthQuad.use();
-////        debugDepthQuad.setFloat("near_plane", near_plane);
-////        debugDepthQuad.setFloat("far_plane", far_plane);
+////        debugDepthQuad.setInt("layer", 0);
 ////        glActiveTexture(GL_TEXTURE0);
-////        glBindTexture(GL_TEXTURE_2D, depthMap);
+////        glBindTexture(GL_TEXTURE_2D_ARRAY, shadowCascades.staticArray); // depthArray only supports compares
 ////        renderQuad();
 //
 //        TERRAIN
@@ -225,27 +454,50 @@ int main() {
         terrainShader.setMat4("projection", projection);
         terrainShader.setMat4("view", view);
         terrainShader.setVec3("viewPos", camera.Position);
-
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(
-                -VERTEX_COUNT / 2.0 + (VERTEX_COUNT - 1) * 0,
-                -30.0,
-                -VERTEX_COUNT / 2.0 + (VERTEX_COUNT - 1) * 0
-                               )
-        );
-        terrainShader.setMat4("model", model);
-        glBindVertexArray(terrainVAO);
-        glDrawElements(GL_TRIANGLES, VERTEX_COUNT * VERTEX_COUNT * 6, GL_UNSIGNED_INT, nullptr);
+        terrainShader.setVec3("light.direction", lightDir);
+        shadowCascades.apply(terrainShader);
+
+        glm::mat4 model = terrainModel;
+
+        renderQueue.setCamera(camera.Position, cameraFar);
+        // the floor and cubes only cast shadows, but the model is drawn lit as well
+        submitModel(renderQueue, shader, PASS_OPAQUE);
+        terrainChunks.cull(projection * view, model, terrainOffsets);
+        terrainChunks.sortNearToFar(camera.Position, model);
+        DrawPacket terrain;
+        terrain.pass = PASS_OPAQUE;
+        terrain.shader = &terrainShader;
+        terrain.vao = terrainArena.vao();
+        terrain.instances = terrainInstances.count();
+        terrain.model = model;
+        terrain.center = glm::vec3(0.0f, -30.0f, 0.0f);
+        terrain.texture(0, GL_TEXTURE_2D_ARRAY, shadowCascades.depthArray);
+        terrain.draw = [](const DrawPacket &packet) { terrainChunks.draw(packet.mode, packet.instances); };
+        if (options.depthPrepass) {
+            // lay down depth with a position-only shader first, then shade only the fragments that won
+            DrawPacket terrainDepth = terrain;
+            terrainDepth.pass = PASS_DEPTH;
+            terrainDepth.shader = &depthPrepassShader;
+            terrainDepth.textureCount = 0;
+            renderQueue.submit(terrainDepth);
+            terrain.depthFunc = GL_EQUAL;
+            terrain.depthWrite = false;
+        }
+        renderQueue.submit(terrain);
 
 //        WATER
         model = glm::mat4(1.0f);
         view = camera.GetViewMatrix();
         model = glm::translate(model, glm::vec3(
                 0.0f,
-                -25.5,
+                WATER_LEVEL,
                 0.0f
                 )
         );
+        depthPrepassShader.use();
+        depthPrepassShader.setMat4("projection", projection);
+        depthPrepassShader.setMat4("view", view);
+
         waterShader.use();
         waterShader.setMat4("projection", projection);
         waterShader.setMat4("view", view);
@@ -253,60 +505,307 @@ int main() {
         waterShader.setMat4("model", model);
         waterShader.setVec3("viewPos", camera.Position);
 
-        waterShader.setFloat("time", glfwGetTime());
-        waterShader.setFloat("speed", opt_speed);
-        waterShader.setFloat("amount", opt_amount);
-        waterShader.setFloat("height", opt_height);
 
 //        glActiveTexture(GL_TEXTURE0);
 //        glBindTexture(GL_TEXTURE_2D, waterTexture);
-        glBindVertexArray(waterVAO);
-        glDrawElements(GL_TRIANGLES, waterIndices->size(), GL_UNSIGNED_INT, 0);
+        DrawPacket waterPacket;
+        waterPacket.pass = PASS_TRANSPARENT;
+        waterPacket.shader = &waterShader;
+        waterPacket.vao = texturedArena.vao();
+        waterPacket.geometry(waterGeometry);
+        waterPacket.model = model;
+        waterPacket.center = glm::vec3(camera.Position.x, WATER_LEVEL, camera.Position.z);
+        // drawn last, over the opaque depth: hidden water fails the depth test before it's shaded and
+        // blended, and the surface doesn't occlude anything drawn after it
+        waterPacket.texture(1, GL_TEXTURE_2D, ocean.displacementMap);
+        waterPacket.texture(2, GL_TEXTURE_2D, ocean.normalMap);
+        waterPacket.depthWrite = false;
+        if (options.reflectionScale > 0.0f) {
+            // the refraction map already shows what's below the surface, so the water is opaque
+            waterPacket.texture(3, GL_TEXTURE_2D, waterReflections.reflectionTexture);
+            waterPacket.texture(4, GL_TEXTURE_2D, waterReflections.refractionTexture);
+        } else {
+            waterPacket.blend = true;
+        }
+        renderQueue.submit(waterPacket);
+
+        if (options.reflectionScale > 0.0f) {
+            // coarse terrain only, without shadows; the chunks are culled right before each pass
+            glm::mat4 reflectionView = camera.GetViewMatrix() * waterReflections.mirror();
+            glm::vec3 reflectionEye(camera.Position.x, 2.0f * WATER_LEVEL - camera.Position.y, camera.Position.z);
+            glm::vec4 reflectionPlane = waterReflections.reflectionPlane();
+            glm::vec4 refractionPlane = waterReflections.refractionPlane();
+            glm::mat4 cameraView = camera.GetViewMatrix();
+            glm::vec3 cameraPosition = camera.Position;
+
+            reflectionTerrainShader.use();
+            reflectionTerrainShader.setMat4("projection", projection);
+            reflectionTerrainShader.setVec3("light.direction", lightDir);
+            DrawPacket reflectedTerrain;
+            reflectedTerrain.pass = PASS_REFLECTION;
+            reflectedTerrain.shader = &reflectionTerrainShader;
+            reflectedTerrain.vao = terrainArena.vao();
+            reflectedTerrain.instances = terrainInstances.count();
+            reflectedTerrain.model = terrainModel;
+            reflectedTerrain.draw = [](const DrawPacket &packet) { terrainLodChunks.draw(packet.mode, packet.instances); };
+            reflectedTerrain.uniforms = [=](const Shader &shader) {
+                shader.setMat4("view", reflectionView);
+                shader.setVec3("viewPos", reflectionEye);
+                shader.setVec4("clipPlane", reflectionPlane);
+            };
+            renderQueue.submit(reflectedTerrain);
+
+            DrawPacket refractedTerrain = reflectedTerrain;
+            refractedTerrain.pass = PASS_REFRACTION;
+            refractedTerrain.uniforms = [=](const Shader &shader) {
+                shader.setMat4("view", cameraView);
+                shader.setVec3("viewPos", cameraPosition);
+                shader.setVec4("clipPlane", refractionPlane);
+            };
+            renderQueue.submit(refractedTerrain);
+
+            reflectionSkyboxShader.use();
+            reflectionSkyboxShader.setMat4("view", glm::mat4(glm::mat3(reflectionView)));
+            reflectionSkyboxShader.setMat4("projection", projection);
+            DrawPacket reflectedSkybox;
+            reflectedSkybox.pass = PASS_REFLECTION;
+            reflectedSkybox.shader = &reflectionSkyboxShader;
+            reflectedSkybox.vao = texturedArena.positionVao();
+            reflectedSkybox.geometry(skyboxGeometry);
+            reflectedSkybox.setModel = false;
+            reflectedSkybox.depthFunc = GL_LEQUAL;
+            // behind everything, so after the terrain in this pass
+            reflectedSkybox.center = camera.Position + glm::vec3(cameraFar);
+            reflectedSkybox.texture(0, GL_TEXTURE_CUBE_MAP, skyboxTexture);
+            renderQueue.submit(reflectedSkybox);
+        }
 
         // SKYBOX
-        glDepthFunc(GL_LEQUAL);
         skyboxShader.use();
         view = glm::mat4(glm::mat3(camera.GetViewMatrix()));
         skyboxShader.setMat4("view", view);
         skyboxShader.setMat4("projection", projection);
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
+        DrawPacket skybox;
+        skybox.pass = PASS_SKYBOX;
+        skybox.shader = &skyboxShader;
+        skybox.vao = texturedArena.positionVao();
+        skybox.geometry(skyboxGeometry);
+        skybox.setModel = false;
+        skybox.depthFunc = GL_LEQUAL;
+        skybox.center = camera.Position;
+        skybox.texture(0, GL_TEXTURE_CUBE_MAP, skyboxTexture);
+        renderQueue.submit(skybox);
+
+        renderQueue.sort();
+        profiler.end();
+
+        profiler.begin("shadow");
+        glm::vec3 propsMin, propsMax;
+        getPropBounds(propsMin, propsMax);
+        shadowCascades.render(
+                [&](int, const glm::mat4 &lightSpaceMatrix) {
+                    terrainLodChunks.cull(lightSpaceMatrix, terrainModel, {});
+                    simpleDepthShader.use();
+                    simpleDepthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+                    renderQueue.execute(PASS_SHADOW, PASS_SHADOW);
+                },
+                [&](int, const glm::mat4 &lightSpaceMatrix) {
+                    simpleDepthShader.use();
+                    simpleDepthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+                    renderQueue.execute(PASS_SHADOW_DYNAMIC, PASS_SHADOW_DYNAMIC);
+                },
+                propsMin, propsMax);
+        shadowStaticRedraws += shadowCascades.stats.staticRedraws;
+        profiler.end();
+
+        if (options.reflectionScale > 0.0f) {
+            ProfileScope scope(profiler, "water_maps");
+            waterReflections.resize(framebufferWidth, framebufferHeight);
+            glm::mat4 cameraView = camera.GetViewMatrix();
+            glEnable(GL_CLIP_DISTANCE0);
+
+            terrainLodChunks.cull(projection * cameraView * waterReflections.mirror(), terrainModel, terrainOffsets);
+            terrainLodChunks.cullPlane(waterReflections.reflectionPlane(), terrainModel, terrainOffsets);
+            waterReflections.bindReflection();
+            renderQueue.execute(PASS_REFLECTION, PASS_REFLECTION);
+
+            terrainLodChunks.cull(projection * cameraView, terrainModel, terrainOffsets);
+            terrainLodChunks.cullPlane(waterReflections.refractionPlane(), terrainModel, terrainOffsets);
+            waterReflections.bindRefraction();
+            renderQueue.execute(PASS_REFRACTION, PASS_REFRACTION);
+
+            glDisable(GL_CLIP_DISTANCE0);
+        }
+
+        // the scene goes to the scaled offscreen target
+        dynamicResolution.bind(framebufferWidth, framebufferHeight);
+        if (options.depthPrepass) {
+            ProfileScope scope(profiler, "depth_prepass");
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            renderQueue.execute(PASS_DEPTH, PASS_DEPTH);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        }
+        {
+            ProfileScope scope(profiler, "terrain");
+            renderQueue.execute(PASS_OPAQUE, PASS_OPAQUE);
+        }
+        {
+            ProfileScope scope(profiler, "skybox");
+            renderQueue.execute(PASS_SKYBOX, PASS_SKYBOX);
+        }
+        {
+            ProfileScope scope(profiler, "water");
+            renderQueue.execute(PASS_TRANSPARENT, PASS_TRANSPARENT);
+        }
+        {
+            ProfileScope scope(profiler, "post");
+            dynamicResolution.present(postShader, sceneFramebuffer, framebufferWidth, framebufferHeight);
+        }
+        profiler.end();
+        scaleSum += dynamicResolution.enabled ? dynamicResolution.scale : 1.0;
 
         // END
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (options.benchmark) {
+            // wait for the GPU so the frame time covers the whole frame
+            glFinish();
+            frameTimes.push_back(
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+            frameIndex++;
+        } else {
+            pacer.wait();
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
 
-//    glDeleteVertexArrays(1, &skyboxVAO);
-//    glDeleteVertexArrays(1, &terrainVAO);
-//    glDeleteVertexArrays(1, &cubeVAO);
-//    glDeleteVertexArrays(1, &floorVAO);
-//    glDeleteBuffers(1, &skyboxVBO);
-//    glDeleteBuffers(1, &cubeVBO);
-
-    glfwTerminate();
+    if (options.benchmark)
+        writeBenchmarkReport(options, frameTimes, scaleSum / std::max(1, frameIndex));
 
+    ocean.stopWorkers();
+    profiler.dump(PROFILE_PATH);
+    profiler.clear();
     return 0;
 }
 
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--benchmark") == 0) {
+            options.benchmark = true;
+        } else if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+            options.frames = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options.seed = (unsigned int) strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            options.output = argv[++i];
+        } else if (strcmp(argv[i], "--pacing") == 0 && hasValue) {
+            i++;
+            if (strcmp(argv[i], "vsync") == 0) {
+                options.pacing = PACING_VSYNC;
+            } else if (strcmp(argv[i], "uncapped") == 0) {
+                options.pacing = PACING_UNCAPPED;
+            } else {
+                options.pacing = PACING_CAPPED;
+                if (strcmp(argv[i], "capped") != 0)
+                    options.fpsCap = std::max(1.0, atof(argv[i]));
+            }
+        } else if (strcmp(argv[i], "--dynamic-resolution") == 0 && hasValue) {
+            i++;
+            options.resolutionTargetMs = strcmp(argv[i], "off") == 0 ? 0.0 : std::max(0.0, atof(argv[i]));
+        } else if (strcmp(argv[i], "--depth-prepass") == 0 && hasValue) {
+            options.depthPrepass = strcmp(argv[++i], "off") != 0;
+        } else if (strcmp(argv[i], "--antialiasing") == 0 && hasValue) {
+            i++;
+            if (strcmp(argv[i], "msaa") == 0)
+                options.antiAliasing = AA_MSAA;
+            else if (strcmp(argv[i], "fxaa") == 0)
+                options.antiAliasing = AA_FXAA;
+            else
+                options.antiAliasing = AA_NONE;
+        } else if (strcmp(argv[i], "--ocean-resolution") == 0 && hasValue) {
+            options.ocean.resolution = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ocean-rate") == 0 && hasValue) {
+            options.ocean.updateRate = std::max(1.0f, (float) atof(argv[++i]));
+        } else if (strcmp(argv[i], "--reflections") == 0 && hasValue) {
+            i++;
+            if (strcmp(argv[i], "off") == 0)
+                options.reflectionScale = 0.0f;
+            else if (strcmp(argv[i], "half") == 0)
+                options.reflectionScale = 0.5f;
+            else if (strcmp(argv[i], "quarter") == 0)
+                options.reflectionScale = 0.25f;
+            else
+                options.reflectionScale = glm::clamp((float) atof(argv[i]), 0.0f, 1.0f);
+        } else if (strcmp(argv[i], "--model") == 0 && hasValue) {
+            options.model = argv[++i];
+        } else if (strcmp(argv[i], "--terrain") == 0 && hasValue) {
+            i++;
+            if (strcmp(argv[i], "preview") == 0)
+                options.terrain = TERRAIN_PREVIEW;
+            else if (strcmp(argv[i], "production") == 0)
+                options.terrain = TERRAIN_PRODUCTION;
+            else
+                options.terrain.resolution = std::max(2, atoi(argv[i]));
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--terrain preview|production|<vertices per side>]"
+                      << " [--pacing vsync|uncapped|capped|<fps cap>] [--dynamic-resolution off|<target ms>]"
+                      << " [--depth-prepass on|off] [--antialiasing none|fxaa|msaa]"
+                      << " [--ocean-resolution N] [--ocean-rate updates per second]"
+                      << " [--reflections off|half|quarter|<fraction>] [--model file.mesh]"
+                      << " [--benchmark [--frames N] [--seed S] [--output report.json]]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
 void framebufferSizeCallback(GLFWwindow *, int width, int height) {
+    framebufferWidth = width;
+    framebufferHeight = height;
     glViewport(0, 0, width, height);
 }
 
-int initOpengl() {
-    glfwInit();
+int initOpengl(bool benchmark) {
+    if (benchmark) {
+        headless = headlessContext.create(SCR_WIDTH, SCR_HEIGHT);
+        if (headless) {
+            glLoader = HeadlessContext::loader();
+            sceneFramebuffer = headlessContext.framebuffer;
+            framebufferWidth = SCR_WIDTH;
+            framebufferHeight = SCR_HEIGHT;
+        } else {
+            std::cout << "Falling back to a hidden window" << std::endl;
+        }
+    }
+
+    if (!headless && createWindow(benchmark) != 0)
+        return -1;
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    // only has an effect on the multisampled scene target; the window itself is single-sampled
+    glEnable(GL_MULTISAMPLE);
+    // blending is switched on per packet by the render queue; destination alpha is left alone so the
+    // scene target stays opaque for the passes that read it
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE);
+
+    return 0;
+}
+
+int createWindow(bool hidden) {
+    if (!glfwInit()) {
+        std::cout << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 4);
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    if (hidden)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
     window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "RAF RG Projekat", nullptr, nullptr);
     if (window == nullptr) {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -314,20 +813,19 @@ int initOpengl() {
         return -1;
     }
     glfwMakeContextCurrent(window);
-    glfwSetCursorPosCallback(window, mouseCallback);
-    glfwSetScrollCallback(window, scrollCallback);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if (!hidden) {
+        glfwSetCursorPosCallback(window, mouseCallback);
+        glfwSetScrollCallback(window, scrollCallback);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
 
     glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    glLoader = (GLADloadproc) glfwGetProcAddress;
+    if (!gladLoadGLLoader(glLoader)) {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_MULTISAMPLE);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
     return 0;
 }
 
@@ -342,6 +840,12 @@ void processInput(GLFWwindow *window) {
         camera.ProcessKeyboard(RIGHT, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+
+    static bool profileKeyDown = false;
+    bool profileKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+    if (profileKey && !profileKeyDown)
+        profiler.dump(PROFILE_PATH);
+    profileKeyDown = profileKey;
 }
 
 void mouseCallback(GLFWwindow *window, double xpos, double ypos) {
@@ -364,12 +868,13 @@ void scrollCallback(GLFWwindow *window, double xoffset, double yoffset) {
 }
 
 
-void createSkybox(unsigned int &texture, unsigned int &VAO, unsigned int &VBO) {
+GeometryRange createSkybox(GLTexture &texture) {
     std::vector<std::string> faces{"../../resources/skybox/right.jpg", "../../resources/skybox/left.jpg",
                                    "../../resources/skybox/top.jpg", "../../resources/skybox/bottom.jpg",
                                    "../../resources/skybox/front.jpg", "../../resources/skybox/back.jpg"};
 
-    texture = loadCubemap(faces);
+    texture.adopt(loadCubemapCached(faces, "../../resources/skybox/skybox.cubemap", SKYBOX_FACE_SIZE));
+    texture.setBytes(textureBytes(GL_TEXTURE_CUBE_MAP, texture));
 
     float skyboxVertices[] = {
             // positions
@@ -391,17 +896,17 @@ void createSkybox(unsigned int &texture, unsigned int &VAO, unsigned int &VBO) {
             -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f, 1.0f,
             -1.0f, 1.0f};
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), skyboxVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *) 0);
+    // the arena also holds texture coordinates; the skybox is drawn with its position-only VAO
+    std::vector<float> vertices;
+    for (int i = 0; i < 36; i++) {
+        vertices.insert(vertices.end(), &skyboxVertices[i * 3], &skyboxVertices[i * 3] + 3);
+        vertices.insert(vertices.end(), {0.0f, 0.0f});
+    }
+    return texturedArena.add(vertices.data(), 36);
 }
 
 
-void createFloor(unsigned int &floorVAO) {
+GeometryRange createFloor() {
     float floorSize = 10.0f;
     float vertices[] = {
             // positions            // normals         // texcoords
@@ -413,69 +918,146 @@ void createFloor(unsigned int &floorVAO) {
             -floorSize, -0.5f, -floorSize, 0.0f, 1.0f, 0.0f, 0.0f, floorSize,
             floorSize, -0.5f, -floorSize, 0.0f, 1.0f, 0.0f, floorSize, floorSize
     };
-    unsigned int floorVBO;
-    glGenVertexArrays(1, &floorVAO);
-    glGenBuffers(1, &floorVBO);
-    glBindVertexArray(floorVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, floorVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) 0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (6 * sizeof(float)));
-    glBindVertexArray(0);
+    return litArena.add(vertices, 6);
 }
 
-void renderScene(const Shader &shader, unsigned int &floorVAO, unsigned int &terrainVAO) {
-    shader.use();
+void createProps() {
+    cubeTransforms.clear();
+    cubeTransforms.push_back(glm::mat4(1.0f)); // light tracker, see updateProps
     glm::mat4 model = glm::mat4(1.0f);
-
-    // floor
-    shader.setMat4("model", model);
-    shader.setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
-    shader.setVec3("light.specular", 0.0f, 0.0f, 1.0f);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, grassTexture);
-    glBindVertexArray(floorVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-//  LIGHT TRACKER
-    shader.setVec3("light.ambient", 0.0f, 0.0f, 0.0f);
-    shader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, lightPos);
-    model = glm::scale(model, glm::vec3(0.1f));
-    shader.setMat4("model", model);
-    shader.setFloat("material.shininess", 0.5f);
-    renderCube();
-    // cubes
-    model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(0.0f, 1.5f, 0.0));
     model = glm::scale(model, glm::vec3(0.5f));
-    shader.setMat4("model", model);
-    renderCube();
+    cubeTransforms.push_back(model);
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(2.0f, 0.0f, 1.0));
     model = glm::scale(model, glm::vec3(0.5f));
-    shader.setMat4("model", model);
-    renderCube();
+    cubeTransforms.push_back(model);
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-1.0f, 0.0f, 2.0));
     model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
     model = glm::scale(model, glm::vec3(0.25));
-    shader.setMat4("model", model);
-    renderCube();
+    cubeTransforms.push_back(model);
+}
+
+// Maps a .mesh file and uploads its meshes into litArena, whose layout is the file's, then scales the
+// model to fit a 2 unit box standing on the floor.
+bool loadModel(const std::string &path) {
+    auto start = std::chrono::steady_clock::now();
+    MeshFile file(path);
+    if (!file.isOpen())
+        return false;
+    glm::vec3 min(1e30f), max(-1e30f);
+    size_t triangles = 0;
+    for (uint32_t mesh = 0; mesh < file.meshCount(); mesh++) {
+        const MeshFileEntry &entry = file.entry(mesh);
+        modelMeshes.push_back(file.upload(mesh, litArena));
+        min = glm::min(min, glm::make_vec3(entry.min));
+        max = glm::max(max, glm::make_vec3(entry.max));
+        triangles += entry.indexCount / 3;
+    }
+    modelLoadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Loaded " << path << ": " << modelMeshes.size() << " meshes, " << triangles << " triangles in "
+              << modelLoadMs << " ms" << std::endl;
+    if (modelMeshes.empty())
+        return true;
+    glm::vec3 size = max - min;
+    float scale = 2.0f / std::max(1e-6f, std::max(size.x, std::max(size.y, size.z)));
+    modelTransform = glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, -0.5f, -2.0f));
+    modelTransform = glm::scale(modelTransform, glm::vec3(scale));
+    modelTransform = glm::translate(modelTransform, -glm::vec3((min.x + max.x) / 2.0f, min.y, (min.z + max.z) / 2.0f));
+    return true;
+}
+
+void updateProps() {
+//  LIGHT TRACKER
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, lightPos);
+    model = glm::scale(model, glm::vec3(0.1f));
+    cubeTransforms[0] = model;
+    cubeInstances.setMatrices(cubeTransforms);
+}
+
+// World-space box around all props; the unit cube's corners are at most sqrt(3)/2 from its center.
+void getPropBounds(glm::vec3 &min, glm::vec3 &max) {
+    min = glm::vec3(1e30f);
+    max = glm::vec3(-1e30f);
+    for (const auto &transform : cubeTransforms) {
+        glm::vec3 center(transform[3]);
+        float extent = 0.87f * std::max(glm::length(glm::vec3(transform[0])),
+                                        std::max(glm::length(glm::vec3(transform[1])),
+                                                 glm::length(glm::vec3(transform[2]))));
+        min = glm::min(min, center - extent);
+        max = glm::max(max, center + extent);
+    }
+}
+
+// A packet over litArena with the state every lit-layout object shares.
+DrawPacket litPacket(const Shader &shader, RenderPass pass) {
+    DrawPacket packet;
+    packet.pass = pass;
+    packet.shader = &shader;
+    // depth-only passes fetch nothing but positions
+    packet.vao = pass == PASS_SHADOW ? litArena.positionVao() : litArena.vao();
+    if (pass != PASS_SHADOW)
+        packet.texture(0, GL_TEXTURE_2D_ARRAY, shadowCascades.depthArray);
+    return packet;
+}
+
+void submitScene(RenderQueue &queue, const Shader &shader, RenderPass pass, const GeometryRange &floorGeometry) {
+    DrawPacket packet = litPacket(shader, pass);
+
+    // floor
+    DrawPacket floor = packet;
+    floor.geometry(floorGeometry);
+    floor.texture(1, GL_TEXTURE_2D, grassTexture);
+    floor.uniforms = [](const Shader &shader) {
+        shader.setBool("instanced", false);
+        shader.setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
+        shader.setVec3("light.specular", 0.0f, 0.0f, 1.0f);
+    };
+    queue.submit(floor);
+
+    // cubes, all in one instanced draw; the light tracker moves, so they're dynamic shadow casters
+    DrawPacket cubes = packet;
+    if (pass == PASS_SHADOW)
+        cubes.pass = PASS_SHADOW_DYNAMIC;
+    cubes.geometry(getCube());
+    cubes.instances = cubeInstances.count();
+    cubes.texture(1, GL_TEXTURE_2D, diffuseMap);
+    cubes.uniforms = [](const Shader &shader) {
+        shader.setBool("instanced", true);
+        shader.setVec3("light.ambient", 0.0f, 0.0f, 0.0f);
+        shader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
+        shader.setFloat("material.shininess", 0.5f);
+    };
+    queue.submit(cubes);
 
+    submitModel(queue, shader, pass);
 }
 
-unsigned int cubeVAO = 0;
-unsigned int cubeVBO = 0;
+// --model, static like the floor
+void submitModel(RenderQueue &queue, const Shader &shader, RenderPass pass) {
+    for (const auto &range : modelMeshes) {
+        DrawPacket mesh = litPacket(shader, pass);
+        mesh.geometry(range);
+        mesh.model = modelTransform;
+        mesh.center = glm::vec3(modelTransform[3]);
+        mesh.texture(1, GL_TEXTURE_2D, containerTexture);
+        mesh.uniforms = [](const Shader &shader) {
+            shader.setBool("instanced", false);
+            shader.setVec3("light.ambient", 0.1f, 0.1f, 0.1f);
+            shader.setVec3("light.specular", 0.5f, 0.5f, 0.5f);
+            shader.setFloat("material.shininess", 32.0f);
+        };
+        queue.submit(mesh);
+    }
+}
 
-void renderCube() {
+GeometryRange cubeGeometry;
+
+const GeometryRange &getCube() {
     // initialize (if necessary)
-    if (cubeVAO == 0) {
+    if (cubeGeometry.vertexCount == 0) {
         float vertices[] = {
                 // back face
                 -1.0f, -1.0f, -1.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
@@ -520,54 +1102,110 @@ void renderCube() {
                 -1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, // top-left
                 -1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f  // bottom-left
         };
-        glGenVertexArrays(1, &cubeVAO);
-        glGenBuffers(1, &cubeVBO);
-        // fill buffer
-        glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-        // link vertex attributes
-        glBindVertexArray(cubeVAO);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) 0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (3 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (6 * sizeof(float)));
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        cubeGeometry = litArena.add(vertices, 36);
+        // the instance stream goes on the arena's VAOs; the floor shares them but doesn't read it
+        cubeInstances.attach(litArena.vao(), 3);
+        cubeInstances.attach(litArena.positionVao(), 3);
     }
-    // render Cube
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, diffuseMap);
-//    glActiveTexture(GL_TEXTURE2);
-//    glBindTexture(GL_TEXTURE_2D, specularMap);
-
-    glBindVertexArray(cubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    return cubeGeometry;
 }
 
-unsigned int quadVAO = 0;
-unsigned int quadVBO;
+GeometryRange quadGeometry;
 
 void renderQuad() {
-    if (quadVAO == 0) {
+    if (quadGeometry.vertexCount == 0) {
         float quadVertices[] = {
                 // positions        // texture Coords
                 -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f,
                 -1.0f, 0.0f, 1.0f, 0.0f,};
-        // setup plane VAO
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *) 0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *) (3 * sizeof(float)));
+        quadGeometry = texturedArena.add(quadVertices, 4);
     }
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(texturedArena.vao());
+    GeometryArena::draw(GL_TRIANGLE_STRIP, quadGeometry);
     glBindVertexArray(0);
 }
+
+// Deletes the GL objects owned by globals, which would otherwise outlive the context.
+void releaseGlResources() {
+    for (GeometryArena *arena : {&terrainArena, &litArena, &texturedArena})
+        arena->destroy();
+    cubeGeometry = GeometryRange();
+    modelMeshes.clear();
+    quadGeometry = GeometryRange();
+    cubeInstances.destroy();
+    terrainInstances.destroy();
+    terrainChunks.destroy();
+    terrainLodChunks.destroy();
+    shadowCascades.destroy();
+    dynamicResolution.destroy();
+    textureCache.clear();
+}
+
+void stepSimulation(SimulationState &state, double step) {
+    state.time += step;
+    state.lightPos.z = sin(state.time * 0.5) * 3.0;
+}
+
+SimulationState interpolateSimulation(const SimulationState &previous, const SimulationState &current, float alpha) {
+    SimulationState state;
+    state.time = previous.time + (current.time - previous.time) * alpha;
+    state.lightPos = glm::mix(previous.lightPos, current.lightPos, alpha);
+    return state;
+}
+
+// Slow orbit over the terrain, dipping towards the water and climbing back, always looking ahead and down.
+void followBenchmarkPath(float time) {
+    float angle = time * 0.3f;
+    glm::vec3 position(cos(angle) * 60.0f, -5.0f + 8.0f * sin(angle * 2.0f), sin(angle) * 60.0f);
+    glm::vec3 target(cos(angle + 0.6f) * 40.0f, -25.0f, sin(angle + 0.6f) * 40.0f);
+    camera.LookAt(position, target);
+}
+
+void writeBenchmarkReport(const Options &options, std::vector<double> frameTimes, double averageScale) {
+    // the first frames pay for shader compilation and cache warm-up
+    int warmup = std::min(BENCHMARK_WARMUP_FRAMES, (int) frameTimes.size() - 1);
+    frameTimes.erase(frameTimes.begin(), frameTimes.begin() + warmup);
+    std::sort(frameTimes.begin(), frameTimes.end());
+    double total = 0.0;
+    for (double time : frameTimes)
+        total += time;
+    double average = total / frameTimes.size();
+    auto percentile = [&](double p) {
+        return frameTimes[std::min(frameTimes.size() - 1, (size_t) (frameTimes.size() * p))];
+    };
+
+    std::ofstream out(options.output);
+    if (!out) {
+        std::cout << "Failed to write benchmark report: " << options.output << std::endl;
+        return;
+    }
+    out << "{\n"
+        << "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\",\n"
+        << "  \"headless\": " << (headless ? "true" : "false") << ",\n"
+        << "  \"width\": " << framebufferWidth << ",\n"
+        << "  \"height\": " << framebufferHeight << ",\n"
+        << "  \"seed\": " << options.seed << ",\n"
+        << "  \"terrain_resolution\": " << options.terrain.resolution << ",\n"
+        << "  \"dynamic_resolution_target_ms\": " << options.resolutionTargetMs << ",\n"
+        << "  \"average_resolution_scale\": " << averageScale << ",\n"
+        << "  \"depth_prepass\": " << (options.depthPrepass ? "true" : "false") << ",\n"
+        << "  \"antialiasing\": \"" << ANTI_ALIASING_NAMES[options.antiAliasing] << "\",\n"
+        << "  \"ocean_resolution\": " << options.ocean.resolution << ",\n"
+        << "  \"reflection_scale\": " << options.reflectionScale << ",\n";
+    if (!options.model.empty())
+        out << "  \"model\": \"" << options.model << "\",\n"
+            << "  \"model_load_ms\": " << modelLoadMs << ",\n";
+    out
+        << "  \"shadow_static_redraws_per_frame\": "
+        << (double) shadowStaticRedraws / (frameTimes.size() + warmup) << ",\n"
+        << "  \"frames\": " << frameTimes.size() << ",\n"
+        << "  \"warmup_frames\": " << warmup << ",\n"
+        << "  \"frame_ms\": {\"min\": " << frameTimes.front() << ", \"avg\": " << average
+        << ", \"median\": " << percentile(0.5) << ", \"p95\": " << percentile(0.95)
+        << ", \"p99\": " << percentile(0.99) << ", \"max\": " << frameTimes.back() << "},\n"
+        << "  \"fps\": " << 1000.0 / average << ",\n"
+        << "  \"gl_live_bytes\": " << glResources.liveBytes() << "\n"
+        << "}\n";
+    std::cout << "Benchmark: " << frameTimes.size() << " frames, avg " << average << " ms, p99 " << percentile(0.99)
+              << " ms, written to " << options.output << std::endl;
+}
@@ -104,6 +104,15 @@ public:
         updateCameraVectors();
     }
 
+    // points the camera from position at target, e.g. for scripted camera paths
+    void LookAt(glm::vec3 position, glm::vec3 target) {
+        Position = position;
+        glm::vec3 direction = glm::normalize(target - position);
+        Yaw = glm::degrees(atan2(direction.z, direction.x));
+        Pitch = glm::degrees(asin(glm::clamp(direction.y, -1.0f, 1.0f)));
+        updateCameraVectors();
+    }
+
     // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
     void ProcessMouseScroll(float yoffset) {
         Zoom -= (float) yoffset;
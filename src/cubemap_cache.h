@@ -0,0 +1,208 @@
+//
+// Skybox loading: the six faces are decoded in parallel once, downsampled and given a full mip chain,
+// then stored in a single binary file that later runs memory-map and upload in one go.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_CUBEMAP_CACHE_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_CUBEMAP_CACHE_H
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "utils.h"
+
+const uint32_t CUBEMAP_CACHE_MAGIC = 0x45425543; // "CUBE"
+const uint32_t CUBEMAP_CACHE_VERSION = 1;
+
+// Pixel data follows the header level by level, six tightly packed RGB8 faces per level.
+struct CubemapCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t maxFaceSize; // the limit the cache was built with; a different limit rebuilds it
+    uint32_t faceSize;
+    uint32_t mipLevels;
+    uint32_t reserved[3];
+};
+
+struct CubemapFace {
+    int size = 0;
+    std::vector<unsigned char> pixels;
+};
+
+// Levels in a full chain from faceSize down to 1x1.
+int cubemapFullChain(int faceSize) {
+    int levels = 1;
+    while (faceSize >> levels)
+        levels++;
+    return levels;
+}
+
+size_t cubemapPayloadSize(int faceSize, int mipLevels) {
+    size_t total = 0;
+    for (int level = 0; level < mipLevels; level++) {
+        size_t size = std::max(1, faceSize >> level);
+        total += size * size * 3 * 6;
+    }
+    return total;
+}
+
+CubemapFace halveFace(const CubemapFace &src) {
+    CubemapFace dst;
+    dst.size = std::max(1, src.size / 2);
+    dst.pixels.resize((size_t) dst.size * dst.size * 3);
+    for (int y = 0; y < dst.size; y++)
+        for (int x = 0; x < dst.size; x++) {
+            int x0 = std::min(x * 2, src.size - 1), x1 = std::min(x * 2 + 1, src.size - 1);
+            int y0 = std::min(y * 2, src.size - 1), y1 = std::min(y * 2 + 1, src.size - 1);
+            for (int c = 0; c < 3; c++) {
+                int sum = src.pixels[(y0 * src.size + x0) * 3 + c] + src.pixels[(y0 * src.size + x1) * 3 + c] +
+                          src.pixels[(y1 * src.size + x0) * 3 + c] + src.pixels[(y1 * src.size + x1) * 3 + c];
+                dst.pixels[(y * dst.size + x) * 3 + c] = (unsigned char) ((sum + 2) / 4);
+            }
+        }
+    return dst;
+}
+
+// Decodes one face and returns its mip chain, starting at no more than maxFaceSize.
+std::vector<CubemapFace> decodeCubemapFace(const std::string &path, int maxFaceSize) {
+    std::vector<CubemapFace> chain;
+    int width, height, nrChannels;
+    unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrChannels, 3);
+    if (!data || width != height) {
+        std::cout << "Cubemap tex failed to load at path: " << path << std::endl;
+        stbi_image_free(data);
+        return chain;
+    }
+
+    CubemapFace face;
+    face.size = width;
+    face.pixels.assign(data, data + (size_t) width * height * 3);
+    stbi_image_free(data);
+
+    while (face.size > maxFaceSize)
+        face = halveFace(face);
+    chain.push_back(face);
+    while (chain.back().size > 1)
+        chain.push_back(halveFace(chain.back()));
+    return chain;
+}
+
+// Uploads a cache payload through a pixel unpack buffer so the driver receives all levels in one transfer.
+void uploadCubemapPayload(const unsigned char *payload, int faceSize, int mipLevels) {
+    size_t payloadSize = cubemapPayloadSize(faceSize, mipLevels);
+    unsigned int pbo;
+    glGenBuffers(1, &pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, payloadSize, payload, GL_STREAM_DRAW);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    size_t offset = 0;
+    for (int level = 0; level < mipLevels; level++) {
+        int size = std::max(1, faceSize >> level);
+        for (unsigned int i = 0; i < 6; i++) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE,
+                         (void *) offset);
+            offset += (size_t) size * size * 3;
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &pbo);
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
+
+bool isCubemapCacheFresh(const std::string &cachePath, const std::vector<std::string> &faces) {
+    std::error_code error;
+    auto cacheTime = std::filesystem::last_write_time(cachePath, error);
+    if (error)
+        return false;
+    for (const auto &face : faces) {
+        auto faceTime = std::filesystem::last_write_time(face, error);
+        if (!error && faceTime > cacheTime)
+            return false;
+    }
+    return true;
+}
+
+unsigned int loadCubemapCached(const std::vector<std::string> &faces, const std::string &cachePath,
+                               int maxFaceSize) {
+    // offline-compressed faces (texture_compressor) are smaller on the GPU than anything we'd cache here
+    bool allCompressed = supportsS3tc();
+    for (const auto &face : faces)
+        allCompressed = allCompressed && std::filesystem::exists(ddsPathFor(face));
+    if (allCompressed)
+        return loadCubemap(faces);
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+
+    if (isCubemapCacheFresh(cachePath, faces)) {
+        MappedFile file(cachePath);
+        CubemapCacheHeader header{};
+        if (file.isOpen() && file.size() >= sizeof(header)) {
+            memcpy(&header, file.data(), sizeof(header));
+            // the face size is checked against the limit before it's used as an int
+            bool valid = header.magic == CUBEMAP_CACHE_MAGIC && header.version == CUBEMAP_CACHE_VERSION &&
+                         (int) header.maxFaceSize == maxFaceSize && header.faceSize > 0 &&
+                         header.faceSize <= (uint32_t) maxFaceSize && header.mipLevels > 0 &&
+                         header.mipLevels <= (uint32_t) cubemapFullChain((int) header.faceSize) &&
+                         file.size() >= sizeof(header) + cubemapPayloadSize(header.faceSize, header.mipLevels);
+            if (valid) {
+                uploadCubemapPayload(file.data() + sizeof(header), header.faceSize, header.mipLevels);
+                return textureID;
+            }
+        }
+    }
+
+    std::vector<std::future<std::vector<CubemapFace>>> decoded;
+    for (const auto &face : faces)
+        decoded.push_back(std::async(std::launch::async, decodeCubemapFace, face, maxFaceSize));
+
+    std::vector<std::vector<CubemapFace>> chains;
+    for (auto &future : decoded)
+        chains.push_back(future.get());
+
+    for (const auto &chain : chains) {
+        if (chain.empty() || chain.size() != chains[0].size() || chain[0].size != chains[0][0].size) {
+            // leave the texture incomplete rather than upload mismatched faces, same as loadCubemap on failure
+            return textureID;
+        }
+    }
+
+    CubemapCacheHeader header{};
+    header.magic = CUBEMAP_CACHE_MAGIC;
+    header.version = CUBEMAP_CACHE_VERSION;
+    header.maxFaceSize = (uint32_t) maxFaceSize;
+    header.faceSize = (uint32_t) chains[0][0].size;
+    header.mipLevels = (uint32_t) chains[0].size();
+    std::vector<unsigned char> payload;
+    payload.reserve(cubemapPayloadSize(header.faceSize, header.mipLevels));
+    for (unsigned int level = 0; level < header.mipLevels; level++)
+        for (const auto &chain : chains)
+            payload.insert(payload.end(), chain[level].pixels.begin(), chain[level].pixels.end());
+
+    std::ofstream out(cachePath, std::ios::binary);
+    out.write((const char *) &header, sizeof(header));
+    out.write((const char *) payload.data(), payload.size());
+    if (!out)
+        std::cout << "Failed to write cubemap cache: " << cachePath << std::endl;
+
+    uploadCubemapPayload(payload.data(), header.faceSize, header.mipLevels);
+    return textureID;
+}
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_CUBEMAP_CACHE_H
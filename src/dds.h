@@ -0,0 +1,180 @@
+//
+// Minimal DDS container for block-compressed textures with a precomputed mip chain.
+// Written by texture_compressor and read back by loadTexture/loadCubemap.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_DDS_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_DDS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+const uint32_t DDS_FOURCC_DXT1 = 0x31545844; // "DXT1" -> BC1
+const uint32_t DDS_FOURCC_DXT5 = 0x35545844; // "DXT5" -> BC3
+
+const uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000;
+const uint32_t DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+const uint32_t DDPF_FOURCC = 0x4;
+const uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+// larger headers are rejected before any level sizes are computed from them
+const uint32_t DDS_MAX_DIMENSION = 16384;
+
+enum DdsFormat {
+    DDS_BC1, // opaque RGB, 8 bytes per 4x4 block
+    DDS_BC3  // RGBA, 16 bytes per 4x4 block
+};
+
+#pragma pack(push, 1)
+struct DdsPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask, gBitMask, bBitMask, aBitMask;
+};
+
+struct DdsHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DdsPixelFormat ddspf;
+    uint32_t caps, caps2, caps3, caps4;
+    uint32_t reserved2;
+};
+#pragma pack(pop)
+
+struct DdsLevel {
+    int width;
+    int height;
+    size_t offset;
+    size_t size;
+};
+
+struct DdsImage {
+    DdsFormat format;
+    int width = 0;
+    int height = 0;
+    std::vector<DdsLevel> levels;
+    std::vector<unsigned char> data;
+};
+
+inline size_t ddsBlockSize(DdsFormat format) {
+    return format == DDS_BC1 ? 8 : 16;
+}
+
+inline size_t ddsLevelSize(DdsFormat format, int width, int height) {
+    return (size_t) ((width + 3) / 4) * ((height + 3) / 4) * ddsBlockSize(format);
+}
+
+// Returns "dir/name.dds" for "dir/name.png"; the compressed twin of a source image.
+inline std::string ddsPathFor(const std::string &path) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return path + ".dds";
+    return path.substr(0, dot) + ".dds";
+}
+
+inline bool loadDds(const std::string &path, DdsImage &image) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    uint32_t magic = 0;
+    DdsHeader header{};
+    bool ok = fread(&magic, sizeof(magic), 1, file) == 1 && magic == DDS_MAGIC &&
+              fread(&header, sizeof(header), 1, file) == 1 && header.size == sizeof(DdsHeader) &&
+              (header.ddspf.flags & DDPF_FOURCC);
+    if (ok) {
+        if (header.ddspf.fourCC == DDS_FOURCC_DXT1)
+            image.format = DDS_BC1;
+        else if (header.ddspf.fourCC == DDS_FOURCC_DXT5)
+            image.format = DDS_BC3;
+        else
+            ok = false;
+    }
+    if (!ok) {
+        fclose(file);
+        return false;
+    }
+
+    // the header is untrusted: bound the size and keep the chain no longer than a full one down to 1x1
+    uint32_t mipMapCount = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount > 0 ? header.mipMapCount : 1;
+    uint32_t fullChain = 1;
+    bool sized = header.width > 0 && header.height > 0 && header.width <= DDS_MAX_DIMENSION &&
+                 header.height <= DDS_MAX_DIMENSION;
+    while (sized && (header.width | header.height) >> fullChain)
+        fullChain++;
+    if (!sized || mipMapCount > fullChain) {
+        fclose(file);
+        return false;
+    }
+
+    image.width = (int) header.width;
+    image.height = (int) header.height;
+    int mipCount = (int) mipMapCount;
+
+    image.levels.clear();
+    size_t total = 0;
+    int w = image.width, h = image.height;
+    for (int i = 0; i < mipCount; i++) {
+        size_t size = ddsLevelSize(image.format, w, h);
+        image.levels.push_back({w, h, total, size});
+        total += size;
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+
+    // don't allocate for levels the file doesn't hold
+    long start = ftell(file);
+    fseek(file, 0, SEEK_END);
+    long end = ftell(file);
+    if (start < 0 || end < start || (size_t) (end - start) < total) {
+        fclose(file);
+        return false;
+    }
+    fseek(file, start, SEEK_SET);
+
+    image.data.resize(total);
+    ok = fread(image.data.data(), 1, total, file) == total;
+    fclose(file);
+    return ok;
+}
+
+inline bool writeDds(const std::string &path, const DdsImage &image) {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    DdsHeader header{};
+    header.size = sizeof(DdsHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE;
+    header.height = image.height;
+    header.width = image.width;
+    header.pitchOrLinearSize = (uint32_t) ddsLevelSize(image.format, image.width, image.height);
+    header.mipMapCount = (uint32_t) image.levels.size();
+    header.ddspf.size = sizeof(DdsPixelFormat);
+    header.ddspf.flags = DDPF_FOURCC;
+    header.ddspf.fourCC = image.format == DDS_BC1 ? DDS_FOURCC_DXT1 : DDS_FOURCC_DXT5;
+    header.caps = DDSCAPS_TEXTURE;
+    if (image.levels.size() > 1) {
+        header.flags |= DDSD_MIPMAPCOUNT;
+        header.caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+    }
+
+    bool ok = fwrite(&DDS_MAGIC, sizeof(DDS_MAGIC), 1, file) == 1 &&
+              fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(image.data.data(), 1, image.data.size(), file) == image.data.size();
+    fclose(file);
+    return ok;
+}
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_DDS_H
@@ -0,0 +1,193 @@
+//
+// Dynamic resolution. The scene is drawn into an offscreen target at a fraction of the output size and
+// stretched onto the output by a bilinear upscale pass. The fraction is steered every frame from the
+// measured GPU frame time towards a target, assuming cost grows with the pixel count (scale squared);
+// on fill-rate bound hosts like llvmpipe that holds well.
+//
+// The target is allocated at full output size and only its lower-left corner is rendered to, so
+// changing the scale never reallocates anything. It holds linear HDR color in R11G11B10F, a third of
+// the bandwidth of RGBA16F; the present pass (post.vert/.frag) tone maps, gamma encodes and runs FXAA
+// in the same full-screen draw as the upscale. With MSAA, the scene is drawn into a multisampled twin
+// of the target that is resolved by a blit before presenting.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_DYNAMIC_RESOLUTION_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_DYNAMIC_RESOLUTION_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include "gl_resources.h"
+#include "shader.h"
+
+enum AntiAliasing {
+    AA_NONE,
+    AA_FXAA, // post-process on the resolved image, costs one pass worth of taps
+    AA_MSAA  // 4 samples per pixel, multiplies the fill and bandwidth of every scene pass
+};
+
+class DynamicResolution {
+public:
+    bool enabled = true;
+    // set before the first bind()
+    AntiAliasing antiAliasing = AA_FXAA;
+    double targetMs;
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float scale = 1.0f;
+
+    explicit DynamicResolution(double targetMs) : targetMs(targetMs) {}
+
+    // Call once the context is current.
+    void init() {
+        // the full-screen triangle is generated from gl_VertexID, but core profile still wants a VAO
+        emptyVAO.create();
+    }
+
+    void destroy() {
+        emptyVAO.reset();
+        framebuffer.reset();
+        colorTexture.reset();
+        depthBuffer.reset();
+        multisampleFramebuffer.reset();
+        multisampleColor.reset();
+        targetWidth = targetHeight = 0;
+    }
+
+    // Feeds the GPU time of a finished frame; frames that had no result yet pass a negative value.
+    void update(double gpuMs) {
+        if (!enabled || gpuMs <= 0.0)
+            return;
+        smoothedMs = smoothedMs <= 0.0 ? gpuMs : smoothedMs + (gpuMs - smoothedMs) * SMOOTHING;
+        float ideal = scale * (float) std::sqrt(targetMs / smoothedMs);
+        // results arrive a few frames late, so only move part of the way to avoid oscillating
+        scale = std::clamp(scale + (ideal - scale) * RESPONSE, minScale, maxScale);
+    }
+
+    // Binds the offscreen (or multisampled) target sized for an output of width x height, sets the scaled viewport
+    // and clears it. Only the scaled corner is cleared; present() never samples the rest of the target.
+    void bind(int width, int height) {
+        if (width != targetWidth || height != targetHeight)
+            createTarget(width, height);
+        float current = enabled ? scale : 1.0f;
+        renderWidth = std::max(1, (int) (width * current));
+        renderHeight = std::max(1, (int) (height * current));
+        glBindFramebuffer(GL_FRAMEBUFFER, multisampleFramebuffer != 0 ? multisampleFramebuffer : framebuffer);
+        glViewport(0, 0, renderWidth, renderHeight);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(0, 0, renderWidth, renderHeight);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
+    }
+
+    // Stretches the rendered part of the target over the whole of the given framebuffer with the
+    // post-process shader (post.vert/.frag, sampler "scene" on unit 0).
+    void present(const Shader &postShader, unsigned int output, int width, int height) {
+        if (multisampleFramebuffer != 0) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, multisampleFramebuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+            glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight,
+                              GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, output);
+        glViewport(0, 0, width, height);
+        glDisable(GL_DEPTH_TEST);
+        postShader.use();
+        postShader.setBool("fxaa", antiAliasing == AA_FXAA);
+        postShader.setVec2("texelSize", glm::vec2(1.0f / targetWidth, 1.0f / targetHeight));
+        postShader.setVec2("uvScale", glm::vec2((float) renderWidth / targetWidth,
+                                                (float) renderHeight / targetHeight));
+        // keep bilinear taps inside the rendered area
+        postShader.setVec2("uvMax", glm::vec2((renderWidth - 0.5f) / targetWidth,
+                                              (renderHeight - 0.5f) / targetHeight));
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, colorTexture);
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    int width() const {
+        return renderWidth;
+    }
+
+    int height() const {
+        return renderHeight;
+    }
+
+private:
+    static constexpr double SMOOTHING = 0.2;
+    static constexpr float RESPONSE = 0.25f;
+    static constexpr int MSAA_SAMPLES = 4;
+
+    GLVertexArray emptyVAO;
+    GLFramebuffer framebuffer;
+    GLTexture colorTexture;
+    GLRenderbuffer depthBuffer;
+    GLFramebuffer multisampleFramebuffer;
+    GLRenderbuffer multisampleColor;
+    int targetWidth = 0, targetHeight = 0;
+    int renderWidth = 0, renderHeight = 0;
+    double smoothedMs = 0.0;
+
+    void createTarget(int width, int height) {
+        bool multisample = antiAliasing == AA_MSAA;
+        if (framebuffer == 0) {
+            framebuffer.create();
+            colorTexture.create();
+            depthBuffer.create();
+            if (multisample) {
+                multisampleFramebuffer.create();
+                multisampleColor.create();
+            }
+        }
+        targetWidth = width;
+        targetHeight = height;
+
+        glBindTexture(GL_TEXTURE_2D, colorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, width, height, 0, GL_RGB, GL_FLOAT, nullptr);
+        long long pixels = (long long) width * height;
+        colorTexture.setBytes(pixels * 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // with MSAA the depth buffer belongs to the multisampled twin; the resolve target needs none
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, multisample ? MSAA_SAMPLES : 0, GL_DEPTH24_STENCIL8,
+                                         width, height);
+        depthBuffer.setBytes(pixels * 4 * (multisample ? MSAA_SAMPLES : 1));
+        if (multisample) {
+            glBindRenderbuffer(GL_RENDERBUFFER, multisampleColor);
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, MSAA_SAMPLES, GL_R11F_G11F_B10F, width, height);
+            multisampleColor.setBytes(pixels * 4 * MSAA_SAMPLES);
+        }
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+        if (!multisample)
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        checkComplete();
+
+        if (multisample) {
+            glBindFramebuffer(GL_FRAMEBUFFER, multisampleFramebuffer);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, multisampleColor);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+            checkComplete();
+        }
+    }
+
+    static void checkComplete() {
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Dynamic resolution target is incomplete" << std::endl;
+    }
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_DYNAMIC_RESOLUTION_H
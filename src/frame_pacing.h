@@ -0,0 +1,105 @@
+//
+// Frame timing. FixedTimestep turns measured frame time into a whole number of fixed simulation
+// steps plus an interpolation factor for rendering in between them. FramePacer owns the monotonic
+// clock and limits how often frames are presented.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_FRAME_PACING_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_FRAME_PACING_H
+
+#include <chrono>
+#include <thread>
+
+#include <GLFW/glfw3.h>
+
+enum FramePacing {
+    PACING_VSYNC,   // swap interval 1, the driver blocks until the next refresh
+    PACING_CAPPED,  // swap interval 0, the CPU sleeps until the next frame slot
+    PACING_UNCAPPED // swap interval 0, frames as fast as possible (benchmarks)
+};
+
+class FixedTimestep {
+public:
+    double step;
+    // bounds the catch-up work after a long stall (e.g. dragging the window)
+    int maxSteps;
+
+    explicit FixedTimestep(double step, int maxSteps = 8) : step(step), maxSteps(maxSteps) {}
+
+    // Adds elapsed real time and returns how many simulation steps are due.
+    int advance(double elapsed) {
+        accumulator += elapsed;
+        int steps = (int) (accumulator / step);
+        if (steps > maxSteps) {
+            steps = maxSteps;
+            accumulator = 0.0;
+        } else {
+            accumulator -= steps * step;
+        }
+        return steps;
+    }
+
+    // How far the present lies between the last two simulation states, in [0, 1).
+    double alpha() const {
+        return accumulator / step;
+    }
+
+private:
+    double accumulator = 0.0;
+};
+
+class FramePacer {
+public:
+    FramePacing mode;
+    double targetFps;
+
+    FramePacer(FramePacing mode, double targetFps) : mode(mode), targetFps(targetFps) {
+        start = lastFrame = deadline = std::chrono::steady_clock::now();
+    }
+
+    // Applies the swap interval; call with the window's context current.
+    void apply() const {
+        glfwSwapInterval(mode == PACING_VSYNC ? 1 : 0);
+    }
+
+    // Seconds since the pacer was created.
+    double now() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Seconds since the previous call.
+    double tick() {
+        auto current = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(current - lastFrame).count();
+        lastFrame = current;
+        return elapsed;
+    }
+
+    // In capped mode, waits for the next frame slot. Sleeps for most of the wait and only spins for the
+    // last millisecond, so a low frame rate leaves the CPU idle instead of busy-waiting.
+    void wait() {
+        if (mode != PACING_CAPPED || targetFps <= 0.0)
+            return;
+        auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1.0 / targetFps));
+        deadline += period;
+        auto current = std::chrono::steady_clock::now();
+        if (deadline < current) {
+            // missed the slot, don't try to catch up with a burst of frames
+            deadline = current;
+            return;
+        }
+        auto spin = std::chrono::milliseconds(1);
+        if (deadline - current > spin)
+            std::this_thread::sleep_until(deadline - spin);
+        while (std::chrono::steady_clock::now() < deadline)
+            std::this_thread::yield();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point lastFrame;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_FRAME_PACING_H
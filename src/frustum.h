@@ -0,0 +1,45 @@
+//
+// View frustum planes extracted from a view-projection matrix, with an AABB visibility test.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_FRUSTUM_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+struct Frustum {
+    // left, right, bottom, top, near, far; xyz is the inward normal, w the distance
+    glm::vec4 planes[6];
+
+    Frustum() = default;
+
+    explicit Frustum(const glm::mat4 &viewProjection) {
+        glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+        glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+        glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+        glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+        planes[0] = row3 + row0;
+        planes[1] = row3 - row0;
+        planes[2] = row3 + row1;
+        planes[3] = row3 - row1;
+        planes[4] = row3 + row2;
+        planes[5] = row3 - row2;
+        for (auto &plane : planes)
+            plane /= glm::length(glm::vec3(plane));
+    }
+
+    // Conservative: may report boxes that straddle a frustum corner as visible.
+    bool isBoxVisible(const glm::vec3 &min, const glm::vec3 &max) const {
+        for (const auto &plane : planes) {
+            glm::vec3 positive(plane.x >= 0 ? max.x : min.x,
+                               plane.y >= 0 ? max.y : min.y,
+                               plane.z >= 0 ? max.z : min.z);
+            if (glm::dot(glm::vec3(plane), positive) + plane.w < 0)
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_FRUSTUM_H
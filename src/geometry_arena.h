@@ -0,0 +1,325 @@
+//
+// Sub-allocated static geometry. An arena owns one large vertex buffer and one index buffer for a
+// vertex layout, plus the VAOs over them; meshes are handed ranges of vertices and indices and are
+// drawn with base-vertex calls, so moving between meshes of the same layout binds nothing. Indices
+// stay relative to their mesh's first vertex.
+//
+// Ranges come from first-fit free lists that merge with their neighbours on release. A full arena
+// grows to twice its size by copying into a new buffer on the GPU.
+//
+// An arena whose shadow casters matter can keep attribute 0 in a buffer of its own, so the
+// position-only VAO reads tightly packed positions instead of striding over the whole vertex.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_GEOMETRY_ARENA_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_GEOMETRY_ARENA_H
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "gl_resources.h"
+
+// Float attributes, interleaved in the order given (the first one optionally in its own stream).
+struct VertexAttribute {
+    unsigned int location;
+    int components;
+};
+
+struct GeometryRange {
+    GLint baseVertex = 0;
+    GLsizei vertexCount = 0;
+    GLuint firstIndex = 0; // in GL_UNSIGNED_INT elements
+    GLsizei indexCount = 0;
+};
+
+class RangeAllocator {
+public:
+    explicit RangeAllocator(size_t capacity = 0) {
+        grow(capacity);
+    }
+
+    // Offset of a free range of size units, or -1 when no free range is large enough.
+    long long allocate(size_t size) {
+        if (size == 0)
+            return 0;
+        for (auto range = freeRanges.begin(); range != freeRanges.end(); ++range) {
+            if (range->second < size)
+                continue;
+            size_t offset = range->first, remaining = range->second - size;
+            freeRanges.erase(range);
+            if (remaining > 0)
+                freeRanges[offset + size] = remaining;
+            return offset;
+        }
+        return -1;
+    }
+
+    void release(size_t offset, size_t size) {
+        if (size == 0)
+            return;
+        auto next = freeRanges.lower_bound(offset);
+        if (next != freeRanges.end() && offset + size == next->first) {
+            size += next->second;
+            next = freeRanges.erase(next);
+        }
+        if (next != freeRanges.begin()) {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second == offset) {
+                previous->second += size;
+                return;
+            }
+        }
+        freeRanges[offset] = size;
+    }
+
+    // Adds the units between the old and the new capacity to the free space.
+    void grow(size_t newCapacity) {
+        if (newCapacity <= total)
+            return;
+        size_t added = newCapacity - total, start = total;
+        total = newCapacity;
+        release(start, added);
+    }
+
+    size_t capacity() const {
+        return total;
+    }
+
+    // Largest single allocation that would currently succeed.
+    size_t largestFree() const {
+        size_t largest = 0;
+        for (const auto &range : freeRanges)
+            largest = std::max(largest, range.second);
+        return largest;
+    }
+
+private:
+    std::map<size_t, size_t> freeRanges; // offset -> size
+    size_t total = 0;
+};
+
+class GeometryArena {
+public:
+    GeometryArena(std::vector<VertexAttribute> layout, bool separatePositions = false,
+                  size_t vertexCapacity = 1 << 16, size_t indexCapacity = 1 << 18)
+            : layout(std::move(layout)), separatePositions(separatePositions), vertexRanges(vertexCapacity),
+              indexRanges(indexCapacity) {
+        for (const auto &attribute : this->layout)
+            stride += attribute.components * sizeof(float);
+        positionStride = this->layout[0].components * sizeof(float);
+        vertexStride = separatePositions ? stride - positionStride : stride;
+    }
+
+    // Call once the context is current.
+    void init() {
+        createBuffer(vertexBuffer, vertexRanges.capacity() * vertexStride);
+        if (separatePositions)
+            createBuffer(positionBuffer, vertexRanges.capacity() * positionStride);
+        indexBuffer.create();
+        vertexArray.create();
+        positionArray.create();
+        glBindVertexArray(vertexArray);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexRanges.capacity() * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+        indexBuffer.setBytes(indexRanges.capacity() * sizeof(GLuint));
+        glBindVertexArray(0);
+        attach();
+    }
+
+    void destroy() {
+        vertexArray.reset();
+        positionArray.reset();
+        vertexBuffer.reset();
+        positionBuffer.reset();
+        indexBuffer.reset();
+    }
+
+    // Copies vertices in the arena's (interleaved) layout, and optionally their indices, into the arena.
+    GeometryRange add(const void *vertices, GLsizei vertexCount, const GLuint *indices = nullptr,
+                      GLsizei indexCount = 0) {
+        GeometryRange range;
+        range.vertexCount = vertexCount;
+        range.baseVertex = (GLint) reserveVertices(vertexCount);
+        if (!separatePositions) {
+            upload(vertexBuffer, (size_t) range.baseVertex * stride, (size_t) vertexCount * stride, vertices);
+        } else {
+            std::vector<char> positions((size_t) vertexCount * positionStride);
+            std::vector<char> attributes((size_t) vertexCount * vertexStride);
+            auto source = (const char *) vertices;
+            for (size_t i = 0; i < (size_t) vertexCount; i++, source += stride) {
+                std::memcpy(&positions[i * positionStride], source, positionStride);
+                std::memcpy(&attributes[i * vertexStride], source + positionStride, vertexStride);
+            }
+            upload(positionBuffer, (size_t) range.baseVertex * positionStride, positions.size(), positions.data());
+            upload(vertexBuffer, (size_t) range.baseVertex * vertexStride, attributes.size(), attributes.data());
+        }
+        if (indexCount > 0) {
+            range.firstIndex = addIndices(indices, indexCount);
+            range.indexCount = indexCount;
+        }
+        return range;
+    }
+
+    // Another index list over vertices that are already in the arena (e.g. a coarser LOD); returns the
+    // first index. Release it with releaseIndices.
+    GLuint addIndices(const GLuint *indices, GLsizei count) {
+        auto first = (GLuint) reserveIndices(count);
+        // the element binding belongs to the VAO, so upload through the arena's own
+        glBindVertexArray(vertexArray);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr) first * sizeof(GLuint), (GLsizeiptr) count * sizeof(GLuint),
+                        indices);
+        glBindVertexArray(0);
+        return first;
+    }
+
+    void release(const GeometryRange &range) {
+        vertexRanges.release(range.baseVertex, range.vertexCount);
+        releaseIndices(range.firstIndex, range.indexCount);
+    }
+
+    void releaseIndices(GLuint first, GLsizei count) {
+        indexRanges.release(first, count);
+    }
+
+    // All attributes of the layout.
+    unsigned int vao() const {
+        return vertexArray;
+    }
+
+    // Attribute 0 only, for depth-only passes.
+    unsigned int positionVao() const {
+        return positionArray;
+    }
+
+    // Bytes per vertex of the layout, as passed to add().
+    GLsizei vertexSize() const {
+        return stride;
+    }
+
+    // Draws a range with one of this arena's VAOs bound.
+    static void draw(GLenum mode, const GeometryRange &range, GLsizei instances = 1) {
+        if (range.indexCount == 0) {
+            glDrawArraysInstanced(mode, range.baseVertex, range.vertexCount, instances);
+            return;
+        }
+        auto offset = (void *) ((size_t) range.firstIndex * sizeof(GLuint));
+        if (instances == 1)
+            glDrawElementsBaseVertex(mode, range.indexCount, GL_UNSIGNED_INT, offset, range.baseVertex);
+        else
+            glDrawElementsInstancedBaseVertex(mode, range.indexCount, GL_UNSIGNED_INT, offset, instances,
+                                              range.baseVertex);
+    }
+
+private:
+    std::vector<VertexAttribute> layout;
+    bool separatePositions;
+    GLsizei stride = 0;         // whole vertex
+    GLsizei positionStride = 0; // attribute 0
+    GLsizei vertexStride = 0;   // what vertexBuffer holds per vertex
+    RangeAllocator vertexRanges;
+    RangeAllocator indexRanges;
+    GLBuffer vertexBuffer;
+    GLBuffer positionBuffer; // only with separatePositions
+    GLBuffer indexBuffer;
+    GLVertexArray vertexArray;
+    GLVertexArray positionArray;
+
+    static void createBuffer(GLBuffer &buffer, size_t bytes) {
+        buffer.create();
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        buffer.setBytes(bytes);
+    }
+
+    static void upload(GLBuffer &buffer, size_t offset, size_t bytes, const void *data) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr) offset, (GLsizeiptr) bytes, data);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Replaces buffer with a larger one holding the same first oldBytes.
+    static void growBuffer(GLBuffer &buffer, size_t oldBytes, size_t newBytes) {
+        GLBuffer grown;
+        grown.create();
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+        grown.setBytes(newBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        buffer = std::move(grown);
+    }
+
+    static size_t grownCapacity(const RangeAllocator &ranges, size_t count) {
+        return std::max(ranges.capacity() * 2, ranges.capacity() + count);
+    }
+
+    // Allocates count vertices, growing the vertex buffers when no free range fits.
+    size_t reserveVertices(size_t count) {
+        long long offset = vertexRanges.allocate(count);
+        if (offset >= 0)
+            return offset;
+
+        size_t capacity = grownCapacity(vertexRanges, count);
+        growBuffer(vertexBuffer, vertexRanges.capacity() * vertexStride, capacity * vertexStride);
+        if (separatePositions)
+            growBuffer(positionBuffer, vertexRanges.capacity() * positionStride, capacity * positionStride);
+        vertexRanges.grow(capacity);
+        // the VAOs still point at the old buffers
+        attach();
+        return vertexRanges.allocate(count);
+    }
+
+    // Allocates count indices, growing the index buffer when no free range fits.
+    size_t reserveIndices(size_t count) {
+        long long offset = indexRanges.allocate(count);
+        if (offset >= 0)
+            return offset;
+
+        size_t capacity = grownCapacity(indexRanges, count);
+        growBuffer(indexBuffer, indexRanges.capacity() * sizeof(GLuint), capacity * sizeof(GLuint));
+        indexRanges.grow(capacity);
+        glBindVertexArray(vertexArray);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBindVertexArray(positionArray);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBindVertexArray(0);
+        return indexRanges.allocate(count);
+    }
+
+    // Points both VAOs at the current buffers.
+    void attach() {
+        glBindVertexArray(vertexArray);
+        size_t offset = 0;
+        for (size_t i = 0; i < layout.size(); i++) {
+            if (i == 0 && separatePositions) {
+                glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+                glVertexAttribPointer(layout[0].location, layout[0].components, GL_FLOAT, GL_FALSE, positionStride,
+                                      (void *) 0);
+            } else {
+                glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+                glVertexAttribPointer(layout[i].location, layout[i].components, GL_FLOAT, GL_FALSE, vertexStride,
+                                      (void *) offset);
+                offset += layout[i].components * sizeof(float);
+            }
+            glEnableVertexAttribArray(layout[i].location);
+        }
+        glBindVertexArray(positionArray);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, separatePositions ? positionBuffer : vertexBuffer);
+        glVertexAttribPointer(layout[0].location, layout[0].components, GL_FLOAT, GL_FALSE,
+                              separatePositions ? positionStride : vertexStride, (void *) 0);
+        glEnableVertexAttribArray(layout[0].location);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_GEOMETRY_ARENA_H
@@ -0,0 +1,236 @@
+//
+// Ownership of GL objects. GLHandle is a move-only wrapper that deletes its object when it goes out of
+// scope; every create and delete is counted by glResources, per object type, together with the bytes
+// owners report for the storage they allocate. At shutdown, whatever is still alive is a leak.
+//
+// Handles convert to the raw name, so they drop into gl* calls unchanged. They must be gone before the
+// context is destroyed; owners that outlive the frame loop (globals) have a destroy() for that.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_GL_RESOURCES_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_GL_RESOURCES_H
+
+#include <algorithm>
+#include <iostream>
+
+#include <glad/glad.h>
+
+enum GLResourceType {
+    GL_RESOURCE_BUFFER,
+    GL_RESOURCE_VERTEX_ARRAY,
+    GL_RESOURCE_TEXTURE,
+    GL_RESOURCE_FRAMEBUFFER,
+    GL_RESOURCE_RENDERBUFFER,
+    GL_RESOURCE_PROGRAM,
+    GL_RESOURCE_TYPES
+};
+
+class GLResourceRegistry {
+public:
+    void created(GLResourceType type) {
+        live[type]++;
+        total[type]++;
+    }
+
+    void destroyed(GLResourceType type, long long size) {
+        live[type]--;
+        bytes[type] -= size;
+    }
+
+    void resized(GLResourceType type, long long delta) {
+        bytes[type] += delta;
+    }
+
+    long long liveObjects(GLResourceType type) const {
+        return live[type];
+    }
+
+    long long liveBytes(GLResourceType type) const {
+        return bytes[type];
+    }
+
+    long long liveBytes() const {
+        long long sum = 0;
+        for (long long size : bytes)
+            sum += size;
+        return sum;
+    }
+
+    // Prints live objects and bytes per type.
+    void report(std::ostream &out) const {
+        for (int type = 0; type < GL_RESOURCE_TYPES; type++)
+            out << NAMES[type] << ": " << live[type] << " live (" << total[type] << " created), "
+                << bytes[type] << " bytes" << std::endl;
+    }
+
+    // Prints every type that still has live objects; returns false if there were any.
+    bool reportLeaks(std::ostream &out) const {
+        bool clean = true;
+        for (int type = 0; type < GL_RESOURCE_TYPES; type++) {
+            if (live[type] == 0)
+                continue;
+            out << "Leaked " << live[type] << " " << NAMES[type] << " object(s), " << bytes[type] << " bytes"
+                << std::endl;
+            clean = false;
+        }
+        return clean;
+    }
+
+private:
+    static constexpr const char *NAMES[GL_RESOURCE_TYPES] = {
+            "buffer", "vertex array", "texture", "framebuffer", "renderbuffer", "program"
+    };
+
+    long long live[GL_RESOURCE_TYPES] = {};
+    long long total[GL_RESOURCE_TYPES] = {};
+    long long bytes[GL_RESOURCE_TYPES] = {};
+};
+
+inline GLResourceRegistry glResources;
+
+template<GLResourceType Type>
+class GLHandle {
+public:
+    GLHandle() = default;
+
+    GLHandle(const GLHandle &) = delete;
+
+    GLHandle &operator=(const GLHandle &) = delete;
+
+    GLHandle(GLHandle &&other) noexcept: id(other.id), size(other.size) {
+        other.id = 0;
+        other.size = 0;
+    }
+
+    GLHandle &operator=(GLHandle &&other) noexcept {
+        if (this != &other) {
+            reset();
+            id = other.id;
+            size = other.size;
+            other.id = 0;
+            other.size = 0;
+        }
+        return *this;
+    }
+
+    ~GLHandle() {
+        reset();
+    }
+
+    // Creates the object, deleting the one held before.
+    unsigned int create() {
+        reset();
+        id = generate();
+        glResources.created(Type);
+        return id;
+    }
+
+    // Takes over an object made by code that returns raw names (the image loaders).
+    void adopt(unsigned int name) {
+        reset();
+        id = name;
+        if (id != 0)
+            glResources.created(Type);
+    }
+
+    void reset() {
+        if (id == 0)
+            return;
+        remove(id);
+        glResources.destroyed(Type, size);
+        id = 0;
+        size = 0;
+    }
+
+    // Records the size of the storage after an allocation, for the per-type byte counts.
+    void setBytes(long long bytes) {
+        glResources.resized(Type, bytes - size);
+        size = bytes;
+    }
+
+    unsigned int get() const {
+        return id;
+    }
+
+    operator unsigned int() const {
+        return id;
+    }
+
+private:
+    unsigned int id = 0;
+    long long size = 0;
+
+    static unsigned int generate() {
+        unsigned int name = 0;
+        if constexpr (Type == GL_RESOURCE_BUFFER)
+            glGenBuffers(1, &name);
+        else if constexpr (Type == GL_RESOURCE_VERTEX_ARRAY)
+            glGenVertexArrays(1, &name);
+        else if constexpr (Type == GL_RESOURCE_TEXTURE)
+            glGenTextures(1, &name);
+        else if constexpr (Type == GL_RESOURCE_FRAMEBUFFER)
+            glGenFramebuffers(1, &name);
+        else if constexpr (Type == GL_RESOURCE_RENDERBUFFER)
+            glGenRenderbuffers(1, &name);
+        else
+            name = glCreateProgram();
+        return name;
+    }
+
+    static void remove(unsigned int name) {
+        if constexpr (Type == GL_RESOURCE_BUFFER)
+            glDeleteBuffers(1, &name);
+        else if constexpr (Type == GL_RESOURCE_VERTEX_ARRAY)
+            glDeleteVertexArrays(1, &name);
+        else if constexpr (Type == GL_RESOURCE_TEXTURE)
+            glDeleteTextures(1, &name);
+        else if constexpr (Type == GL_RESOURCE_FRAMEBUFFER)
+            glDeleteFramebuffers(1, &name);
+        else if constexpr (Type == GL_RESOURCE_RENDERBUFFER)
+            glDeleteRenderbuffers(1, &name);
+        else
+            glDeleteProgram(name);
+    }
+};
+
+typedef GLHandle<GL_RESOURCE_BUFFER> GLBuffer;
+typedef GLHandle<GL_RESOURCE_VERTEX_ARRAY> GLVertexArray;
+typedef GLHandle<GL_RESOURCE_TEXTURE> GLTexture;
+typedef GLHandle<GL_RESOURCE_FRAMEBUFFER> GLFramebuffer;
+typedef GLHandle<GL_RESOURCE_RENDERBUFFER> GLRenderbuffer;
+typedef GLHandle<GL_RESOURCE_PROGRAM> GLProgram;
+
+// Storage of a texture summed over its mip levels, read back from GL for textures whose loaders don't
+// report a size. Binds the texture to target.
+inline long long textureBytes(GLenum target, unsigned int texture) {
+    glBindTexture(target, texture);
+    GLenum levelTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+    long long faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    long long total = 0;
+    for (int level = 0; level < 16; level++) {
+        GLint width = 0, height = 0, depth = 0, compressed = 0;
+        glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_WIDTH, &width);
+        if (width == 0)
+            break;
+        glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_HEIGHT, &height);
+        glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_DEPTH, &depth);
+        glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_COMPRESSED, &compressed);
+        if (compressed) {
+            GLint size = 0;
+            glGetTexLevelParameteriv(levelTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+            total += size * faces;
+            continue;
+        }
+        GLint bits = 0;
+        for (GLenum channel : {GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE,
+                               GL_TEXTURE_DEPTH_SIZE}) {
+            GLint channelBits = 0;
+            glGetTexLevelParameteriv(levelTarget, level, channel, &channelBits);
+            bits += channelBits;
+        }
+        total += (long long) width * height * std::max(depth, 1) * (bits / 8) * faces;
+    }
+    return total;
+}
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_GL_RESOURCES_H
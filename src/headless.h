@@ -0,0 +1,133 @@
+//
+// Offscreen GL context for running without a window system. Uses EGL on Mesa's surfaceless platform
+// (works with llvmpipe on machines without a GPU) and renders into a framebuffer object that stands in
+// for the window's default framebuffer. Only available when the build found EGL (RAF_HEADLESS_EGL).
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_HEADLESS_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_HEADLESS_H
+
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include "gl_resources.h"
+
+#ifdef RAF_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+class HeadlessContext {
+public:
+    GLFramebuffer framebuffer;
+    int width = 0;
+    int height = 0;
+
+    // Creates the context, makes it current and loads GL. Returns false if no headless context is possible.
+    bool create(int frameWidth, int frameHeight) {
+#ifdef RAF_HEADLESS_EGL
+        width = frameWidth;
+        height = frameHeight;
+
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay != nullptr)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+            std::cout << "Failed to initialize EGL" << std::endl;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            std::cout << "EGL display doesn't support desktop OpenGL" << std::endl;
+            return false;
+        }
+
+        // no surface is ever created, so any config that can render GL will do
+        EGLint configAttributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        EGLConfig config = nullptr;
+        EGLint configCount = 0;
+        eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+
+        EGLint contextAttributes[] = {
+                EGL_CONTEXT_MAJOR_VERSION, 3,
+                EGL_CONTEXT_MINOR_VERSION, 3,
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                EGL_NONE
+        };
+        context = eglCreateContext(display, configCount > 0 ? config : (EGLConfig) nullptr, EGL_NO_CONTEXT,
+                                   contextAttributes);
+        if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+            std::cout << "Failed to create a headless GL context" << std::endl;
+            return false;
+        }
+        if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return false;
+        }
+
+        colorBuffer.create();
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        colorBuffer.setBytes((long long) width * height * 4);
+        depthBuffer.create();
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        depthBuffer.setBytes((long long) width * height * 4);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        framebuffer.create();
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Headless framebuffer is incomplete" << std::endl;
+            destroy();
+            return false;
+        }
+        glViewport(0, 0, width, height);
+        return true;
+#else
+        (void) frameWidth;
+        (void) frameHeight;
+        std::cout << "Built without EGL, headless contexts are unavailable" << std::endl;
+        return false;
+#endif
+    }
+
+    void destroy() {
+#ifdef RAF_HEADLESS_EGL
+        if (context != EGL_NO_CONTEXT) {
+            framebuffer.reset();
+            colorBuffer.reset();
+            depthBuffer.reset();
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(display, context);
+            context = EGL_NO_CONTEXT;
+        }
+        if (display != EGL_NO_DISPLAY) {
+            eglTerminate(display);
+            display = EGL_NO_DISPLAY;
+        }
+#endif
+    }
+
+    static GLADloadproc loader() {
+#ifdef RAF_HEADLESS_EGL
+        return (GLADloadproc) eglGetProcAddress;
+#else
+        return nullptr;
+#endif
+    }
+
+private:
+    GLRenderbuffer colorBuffer;
+    GLRenderbuffer depthBuffer;
+#ifdef RAF_HEADLESS_EGL
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+#endif
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_HEADLESS_H
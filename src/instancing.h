@@ -0,0 +1,93 @@
+//
+// Per-instance vertex streams. An InstanceBuffer holds one offset (vec3) or model matrix (mat4) per
+// instance and is attached to a mesh VAO with an attribute divisor of 1, so N copies of the mesh go
+// out in a single glDraw*Instanced call.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_INSTANCING_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_INSTANCING_H
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl_resources.h"
+
+enum InstanceLayout {
+    INSTANCE_OFFSET, // vec3, one attribute location
+    INSTANCE_MATRIX  // mat4, four consecutive attribute locations
+};
+
+class InstanceBuffer {
+public:
+    explicit InstanceBuffer(InstanceLayout layout) : layout(layout) {}
+
+    // Binds the instance stream to `location` of the given VAO. Safe to call again for a rebuilt VAO.
+    void attach(unsigned int vao, unsigned int location) {
+        ensureBuffer();
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if (layout == INSTANCE_OFFSET) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *) 0);
+            glVertexAttribDivisor(location, 1);
+        } else {
+            for (unsigned int i = 0; i < 4; i++) {
+                glEnableVertexAttribArray(location + i);
+                glVertexAttribPointer(location + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                                      (void *) (i * sizeof(glm::vec4)));
+                glVertexAttribDivisor(location + i, 1);
+            }
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    void setOffsets(const std::vector<glm::vec3> &offsets) {
+        upload(offsets.data(), offsets.size() * sizeof(glm::vec3));
+        instances = offsets.size();
+    }
+
+    void setMatrices(const std::vector<glm::mat4> &matrices) {
+        upload(matrices.data(), matrices.size() * sizeof(glm::mat4));
+        instances = matrices.size();
+    }
+
+    GLsizei count() const {
+        return instances;
+    }
+
+    // Deletes the buffer; it is recreated by the next upload.
+    void destroy() {
+        VBO.reset();
+        capacity = 0;
+    }
+
+private:
+    InstanceLayout layout;
+    GLBuffer VBO;
+    size_t capacity = 0;
+    GLsizei instances = 0;
+
+    // created lazily because instance buffers may be declared before the GL context exists
+    void ensureBuffer() {
+        if (VBO == 0)
+            VBO.create();
+    }
+
+    // Grows the store when needed, otherwise orphans it so per-frame updates never wait on the GPU.
+    void upload(const void *data, size_t bytes) {
+        ensureBuffer();
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if (bytes > capacity)
+            capacity = bytes;
+        glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+        VBO.setBytes(capacity);
+        if (bytes > 0)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_INSTANCING_H
@@ -1,9 +1,35 @@
 #ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_MAP_GENERATOR_H
 #define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_MAP_GENERATOR_H
 
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "geometry_arena.h"
 #include "perlin.h"
+#include "terrain_chunks.h"
+#include "vertex_cache.h"
+
+// Terrain grid resolution is chosen at runtime; the world size stays the same, so a higher resolution
+// only adds detail.
+struct TerrainConfig {
+    int resolution = 200; // vertices per side
+    float size = 199.0f;  // world units per side
 
-const float VERTEX_COUNT = 200;
+    float spacing() const {
+        return size / (resolution - 1);
+    }
+};
+
+const TerrainConfig TERRAIN_PREVIEW{65};
+const TerrainConfig TERRAIN_PRODUCTION{1025};
+
+// the shadow LOD keeps about this many quads per side, whatever the resolution
+const int TERRAIN_SHADOW_LOD_QUADS = 50;
 float WATER_HEIGHT = 0.1;
 
 int octaves = 5;
@@ -12,47 +38,102 @@ float noiseScale = 64;
 float persistence = 0.5;
 float lacunarity = 2;
 
-std::vector<int> generateIndices() {
-    std::vector<int> indices;
+// Calls kernel with the resolution as a std::integral_constant. The common 2^n + 1 sizes get their own
+// instantiation, so inside it the grid stride and loop bounds are compile-time constants; any other
+// resolution runs the generic instantiation (value 0) that reads it at runtime.
+template<typename Kernel>
+auto dispatchResolution(int resolution, Kernel &&kernel) {
+    switch (resolution) {
+        case 65:
+            return kernel(std::integral_constant<int, 65>());
+        case 129:
+            return kernel(std::integral_constant<int, 129>());
+        case 257:
+            return kernel(std::integral_constant<int, 257>());
+        case 513:
+            return kernel(std::integral_constant<int, 513>());
+        case 1025:
+            return kernel(std::integral_constant<int, 1025>());
+        default:
+            return kernel(std::integral_constant<int, 0>());
+    }
+}
 
-    int pos = 0;
-    for (int y = 0; y < VERTEX_COUNT; y++)
-        for (int x = 0; x < VERTEX_COUNT; x++) {
-
-            if (x == VERTEX_COUNT - 1 || y == VERTEX_COUNT - 1) {
-                // Don't create indices for right or top edge
-                pos++;
-                continue;
-            } else {
-                // Top left triangle of square
-                indices.push_back(pos + VERTEX_COUNT);
-                indices.push_back(pos);
-                indices.push_back(pos + VERTEX_COUNT + 1);
-                // Bottom right triangle of square
-                indices.push_back(pos + 1);
-                indices.push_back(pos + 1 + VERTEX_COUNT);
-                indices.push_back(pos);
-            }
-            pos++;
+template<int N>
+std::vector<int> generateIndicesKernel(int resolution) {
+    const int size = N > 0 ? N : resolution;
+    std::vector<int> indices((size_t) (size - 1) * (size - 1) * 6);
+
+    // no quads start on the right or top edge
+    size_t i = 0;
+    for (int y = 0; y < size - 1; y++)
+        for (int x = 0; x < size - 1; x++) {
+            int pos = y * size + x;
+            // Top left triangle of square
+            indices[i++] = pos + size;
+            indices[i++] = pos;
+            indices[i++] = pos + size + 1;
+            // Bottom right triangle of square
+            indices[i++] = pos + 1;
+            indices[i++] = pos + 1 + size;
+            indices[i++] = pos;
+        }
+
+    return indices;
+}
+
+std::vector<int> generateIndices(const TerrainConfig &config) {
+    return dispatchResolution(config.resolution, [&](auto fixed) {
+        return generateIndicesKernel<decltype(fixed)::value>(config.resolution);
+    });
+}
+
+// Indices over every step-th grid vertex (the last row and column are always kept), in the same quad
+// order as generateIndices. gridSize receives the number of sampled vertices per row.
+std::vector<int> generateLodIndices(const TerrainConfig &config, int step, int &gridSize) {
+    std::vector<int> samples;
+    for (int i = 0; i < config.resolution - 1; i += step)
+        samples.push_back(i);
+    samples.push_back(config.resolution - 1);
+    gridSize = samples.size();
+
+    std::vector<int> indices;
+    int row = config.resolution;
+    for (int y = 0; y < gridSize - 1; y++)
+        for (int x = 0; x < gridSize - 1; x++) {
+            int pos = samples[y] * row + samples[x];
+            int right = samples[y] * row + samples[x + 1];
+            int up = samples[y + 1] * row + samples[x];
+            int upRight = samples[y + 1] * row + samples[x + 1];
+            indices.push_back(up);
+            indices.push_back(pos);
+            indices.push_back(upRight);
+            indices.push_back(right);
+            indices.push_back(upRight);
+            indices.push_back(pos);
         }
 
     return indices;
 }
 
 float randomModifier() {
+    std::lock_guard<std::mutex> lock(worldSeedMutex);
     float modifier = ((float) rand()) / RAND_MAX;
-    srand((unsigned int) time(NULL));
+    srand(worldSeed);
     modifier = ((float) rand()) / RAND_MAX;
     modifier = ((float) rand()) / RAND_MAX;
     return modifier + 1.0f;
 }
 
-std::vector<float> generateNoiseMap() {
+template<int N>
+std::vector<float> generateNoiseMapKernel(int resolution, float spacing) {
+    const int size = N > 0 ? N : resolution;
     int offsetX = 0;
     int offsetY = 0;
-    std::vector<float> noiseValues;
-    std::vector<float> normalizedNoiseValues;
+    std::vector<float> normalizedNoiseValues((size_t) size * size);
     std::vector<int> p = get_permutation_vector();
+    // reseeds from worldSeed, so it's the same for every vertex and only needs computing once
+    float modifier = randomModifier();
 
     float amp = 1;
     float freq = 1;
@@ -63,16 +144,14 @@ std::vector<float> generateNoiseMap() {
         amp *= persistence;
     }
 
-    for (int y = 0; y < VERTEX_COUNT; y++) {
-
-        for (int x = 0; x < VERTEX_COUNT; x++) {
-            float modifier = randomModifier();
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
             amp = 1;
             freq = 1;
             float noiseHeight = 0;
             for (int i = 0; i < octaves; i++) {
-                float xSample = (x + offsetX * (VERTEX_COUNT - 1)) / noiseScale * freq;
-                float ySample = (y + offsetY * (VERTEX_COUNT - 1)) / noiseScale * freq;
+                float xSample = (x * spacing + offsetX * (size - 1) * spacing) / noiseScale * freq;
+                float ySample = (y * spacing + offsetY * (size - 1) * spacing) / noiseScale * freq;
 
                 float perlinValue = perlin_noise(xSample * modifier, ySample * modifier, p);
                 noiseHeight += perlinValue * amp;
@@ -80,61 +159,63 @@ std::vector<float> generateNoiseMap() {
                 freq *= lacunarity;
             }
 
-            noiseValues.push_back(noiseHeight);
-        }
-    }
-
-    for (int y = 0; y < VERTEX_COUNT; y++) {
-        for (int x = 0; x < VERTEX_COUNT; x++) {
             // Inverse lerp and scale values to range from 0 to 1
-            normalizedNoiseValues.push_back((noiseValues[x + y * VERTEX_COUNT] + 1) / maxPossibleHeight);
+            normalizedNoiseValues[x + y * size] = (noiseHeight + 1) / maxPossibleHeight;
         }
     }
 
     return normalizedNoiseValues;
 }
 
-std::vector<float> generateVertices(const std::vector<float> &noise_map) {
-    std::vector<float> v;
+std::vector<float> generateNoiseMap(const TerrainConfig &config) {
+    return dispatchResolution(config.resolution, [&](auto fixed) {
+        return generateNoiseMapKernel<decltype(fixed)::value>(config.resolution, config.spacing());
+    });
+}
 
-    for (int y = 0; y < VERTEX_COUNT + 1; y++)
-        for (int x = 0; x < VERTEX_COUNT; x++) {
-            v.push_back(x);
-            float easedNoise = std::pow(noise_map[x + y * VERTEX_COUNT] * 1.1, 3);
-            v.push_back(std::fmax(easedNoise * meshHeight, WATER_HEIGHT * 0.5 * meshHeight));
-            v.push_back(y);
+template<int N>
+std::vector<float> generateVerticesKernel(const std::vector<float> &noise_map, int resolution, float spacing) {
+    const int size = N > 0 ? N : resolution;
+    std::vector<float> v((size_t) size * size * 3);
+    float minHeight = WATER_HEIGHT * 0.5 * meshHeight;
+
+    size_t i = 0;
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++) {
+            float easedNoise = std::pow(noise_map[x + y * size] * 1.1f, 3.0f);
+            v[i++] = x * spacing;
+            v[i++] = std::fmax(easedNoise * meshHeight, minHeight);
+            v[i++] = y * spacing;
         }
 
     return v;
 }
 
-std::vector<float> generateNormals(const std::vector<int> &indices, const std::vector<float> &vertices) {
-    int pos;
-    glm::vec3 normal;
-    std::vector<float> normals;
-    std::vector<glm::vec3> verts;
-
-    // Get the vertices of each triangle in mesh
-    // For each group of indices
-    for (int i = 0; i < indices.size(); i += 3) {
-
-        // Get the vertices (point) for each index
-        for (int j = 0; j < 3; j++) {
-            pos = indices[i + j] * 3;
-            verts.push_back(glm::vec3(vertices[pos], vertices[pos + 1], vertices[pos + 2]));
-        }
-
-        // Get vectors of two edges of triangle
-        glm::vec3 U = verts[i + 1] - verts[i];
-        glm::vec3 V = verts[i + 2] - verts[i];
+std::vector<float> generateVertices(const std::vector<float> &noise_map, const TerrainConfig &config) {
+    return dispatchResolution(config.resolution, [&](auto fixed) {
+        return generateVerticesKernel<decltype(fixed)::value>(noise_map, config.resolution, config.spacing());
+    });
+}
 
-        // Calculate normal
-        normal = glm::normalize(-glm::cross(U, V));
-        normals.push_back(normal.x);
-        normals.push_back(normal.y);
-        normals.push_back(normal.z);
+// One normal per vertex: the area-weighted average of the faces around it.
+std::vector<float> generateNormals(const std::vector<int> &indices, const std::vector<float> &vertices) {
+    std::vector<glm::vec3> sums(vertices.size() / 3, glm::vec3(0.0f));
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        glm::vec3 a = glm::make_vec3(&vertices[indices[i] * 3]);
+        glm::vec3 b = glm::make_vec3(&vertices[indices[i + 1] * 3]);
+        glm::vec3 c = glm::make_vec3(&vertices[indices[i + 2] * 3]);
+        // the grid winds clockwise seen from above, so the face normal is the negated cross product
+        glm::vec3 normal = -glm::cross(b - a, c - a);
+        for (int corner = 0; corner < 3; corner++)
+            sums[indices[i + corner]] += normal;
     }
 
+    std::vector<float> normals;
+    normals.reserve(vertices.size());
+    for (const auto &sum : sums) {
+        glm::vec3 normal = glm::length(sum) > 0.0f ? glm::normalize(sum) : glm::vec3(0.0f, 1.0f, 0.0f);
+        normals.insert(normals.end(), {normal.x, normal.y, normal.z});
+    }
     return normals;
 }
 
@@ -181,7 +262,10 @@ std::vector<float> generateColors(const std::vector<float> &vertices) {
     return colors;
 }
 
-void generateMap(unsigned int &VAO) {
+// Uploads the terrain into arena, whose layout is position, normal, color (three floats each). chunks
+// draw the full terrain; lodChunks index a coarser LOD over the same vertices, drawn with the arena's
+// position-only VAO by shadow casters and with its full VAO by the reduced-resolution water passes.
+void generateMap(const TerrainConfig &config, GeometryArena &arena, TerrainChunks &chunks, TerrainChunks &lodChunks) {
     std::vector<int> indices;
     std::vector<float> noise_map;
     std::vector<float> vertices;
@@ -189,50 +273,39 @@ void generateMap(unsigned int &VAO) {
     std::vector<float> colors;
 
     // Generate map
-    indices = generateIndices();
-    noise_map = generateNoiseMap();
-    vertices = generateVertices(noise_map);
+    indices = generateIndices(config);
+    noise_map = generateNoiseMap(config);
+    vertices = generateVertices(noise_map, config);
     normals = generateNormals(indices, vertices);
     colors = generateColors(vertices);
+    // normals are per vertex, so regrouping the indices into chunks doesn't change the shading
+    indices = chunks.build(indices, vertices, config.resolution);
+    int lodStep = std::max(1, (config.resolution - 1 + TERRAIN_SHADOW_LOD_QUADS - 1) / TERRAIN_SHADOW_LOD_QUADS);
+    int lodGridSize;
+    std::vector<int> lodIndices = generateLodIndices(config, lodStep, lodGridSize);
+    lodIndices = lodChunks.build(lodIndices, vertices, lodGridSize);
+    // each chunk is reordered for the vertex cache on its own, so it stays one contiguous range
+    for (const auto &chunk : chunks.chunks)
+        optimizeVertexCache(&indices[chunk.firstIndex], chunk.count);
+    for (const auto &chunk : lodChunks.chunks)
+        optimizeVertexCache(&lodIndices[chunk.firstIndex], chunk.count);
+
+    // the arena takes whole interleaved vertices (and splits off the positions itself)
+    size_t vertexCount = vertices.size() / 3;
+    std::vector<float> interleaved;
+    interleaved.reserve(vertexCount * 9);
+    for (size_t i = 0; i < vertexCount; i++) {
+        interleaved.insert(interleaved.end(), &vertices[i * 3], &vertices[i * 3] + 3);
+        interleaved.insert(interleaved.end(), &normals[i * 3], &normals[i * 3] + 3);
+        interleaved.insert(interleaved.end(), &colors[i * 3], &colors[i * 3] + 3);
+    }
 
-    unsigned int pVBO, nVBO, cVBO, EBO;
-
-    // Create buffers and arrays
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &pVBO);
-    glGenBuffers(1, &nVBO);
-    glGenBuffers(1, &cVBO);
-    glGenBuffers(1, &EBO);
-
-    // Bind vertices to VBO
-    glBindVertexArray(VAO);
-
-    // Create element buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(int), &indices[0], GL_STATIC_DRAW);
-
-    // position
-    glBindBuffer(GL_ARRAY_BUFFER, pVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    // normals
-    glBindBuffer(GL_ARRAY_BUFFER, nVBO);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(float), &normals[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *) 0);
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    // colors
-    glBindBuffer(GL_ARRAY_BUFFER, cVBO);
-    glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(float), &colors[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *) 0);
-    glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    glBindVertexArray(0);
+    // the indices are non-negative, so they can be uploaded as GLuint as they are
+    chunks.range = arena.add(interleaved.data(), (GLsizei) vertexCount, (const GLuint *) indices.data(),
+                             (GLsizei) indices.size());
+    lodChunks.range = chunks.range;
+    lodChunks.range.firstIndex = arena.addIndices((const GLuint *) lodIndices.data(), (GLsizei) lodIndices.size());
+    lodChunks.range.indexCount = (GLsizei) lodIndices.size();
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
@@ -0,0 +1,99 @@
+//
+// Read-only memory-mapped file.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_MAPPED_FILE_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            return;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+            return;
+        void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+            return;
+        bytes = (const unsigned char *) view;
+        length = (size_t) fileSize.QuadPart;
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info{};
+        if (fstat(fd, &info) != 0 || info.st_size == 0)
+            return;
+        void *view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED)
+            return;
+        bytes = (const unsigned char *) view;
+        length = (size_t) info.st_size;
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (bytes)
+            UnmapViewOfFile(bytes);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (bytes)
+            munmap((void *) bytes, length);
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool isOpen() const {
+        return bytes != nullptr;
+    }
+
+    const unsigned char *data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_MAPPED_FILE_H
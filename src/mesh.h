@@ -6,7 +6,9 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "geometry_arena.h"
 #include "shader.h"
+#include "vertex_cache.h"
 
 #include <string>
 #include <vector>
@@ -26,28 +28,75 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// Arena layouts for Vertex: all of it (56 bytes), or only position, normal and texture coordinates
+// (32 bytes) for meshes drawn without normal maps. Meshes go into an arena created with either.
+const vector<VertexAttribute> MESH_VERTEX_LAYOUT{{0, 3}, {1, 3}, {2, 2}, {3, 3}, {4, 3}};
+const vector<VertexAttribute> MESH_COMPACT_VERTEX_LAYOUT{{0, 3}, {1, 3}, {2, 2}};
+
+struct MeshOptions {
+    bool optimize = true;    // reorder triangles for the vertex cache and vertices for fetch locality
+    bool keepCpuCopy = true; // keep vertices and indices after upload; otherwise they are freed
+};
+
 struct Texture {
     unsigned int id;
     string type;
     string path;
 };
 
+// Owns a range of a geometry arena, so it can be moved but not copied.
 class Mesh {
 public:
-    // mesh Data
+    // mesh Data; vertices and indices are empty after upload unless the mesh keeps a CPU copy
     vector<Vertex> vertices;
     vector<unsigned int> indices;
     vector<Texture> textures;
-    unsigned int VAO;
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures) {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+    // constructor; takes the data by value, so callers that std::move it in copy nothing
+    Mesh(GeometryArena &arena, vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures,
+         MeshOptions options = MeshOptions())
+            : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)),
+              arena(&arena) {
+        if (options.optimize) {
+            optimizeVertexCache(this->indices);
+            optimizeVertexFetch(this->vertices, this->indices);
+        }
 
-        // now that we have all the required data, set the vertex buffers and its attribute pointers.
+        // now that we have all the required data, upload it into the arena.
         setupMesh();
+
+        if (!options.keepCpuCopy) {
+            vector<Vertex>().swap(this->vertices);
+            vector<unsigned int>().swap(this->indices);
+        }
+    }
+
+    Mesh(const Mesh &) = delete;
+
+    Mesh &operator=(const Mesh &) = delete;
+
+    Mesh(Mesh &&other) noexcept
+            : vertices(std::move(other.vertices)), indices(std::move(other.indices)),
+              textures(std::move(other.textures)), arena(other.arena), range(other.range) {
+        other.arena = nullptr;
+    }
+
+    Mesh &operator=(Mesh &&other) noexcept {
+        if (this != &other) {
+            release();
+            vertices = std::move(other.vertices);
+            indices = std::move(other.indices);
+            textures = std::move(other.textures);
+            arena = other.arena;
+            range = other.range;
+            other.arena = nullptr;
+        }
+        return *this;
+    }
+
+    // gives the range back to the arena
+    ~Mesh() {
+        release();
     }
 
     // render the mesh
@@ -78,8 +127,8 @@ public:
         }
 
         // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(arena->vao());
+        GeometryArena::draw(GL_TRIANGLES, range);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
@@ -87,45 +136,34 @@ public:
     }
 
 private:
-    // render data 
-    unsigned int VBO, EBO;
+    // render data
+    GeometryArena *arena;
+    GeometryRange range;
 
-    // initializes all the buffer objects/arrays
+    // copies the vertices and indices into the arena, which owns the buffers and attribute pointers
     void setupMesh() {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) 0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, Bitangent));
+        if (arena->vertexSize() == sizeof(Vertex)) {
+            // A great thing about structs is that their memory layout is sequential for all its items.
+            // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+            // again translates to 3/2 floats which translates to a byte array.
+            range = arena->add(vertices.data(), vertices.size(), indices.data(), indices.size());
+            return;
+        }
+        // compact layout: leave out tangent and bitangent
+        vector<float> packed;
+        packed.reserve(vertices.size() * 8);
+        for (const Vertex &vertex : vertices) {
+            packed.insert(packed.end(), &vertex.Position.x, &vertex.Position.x + 3);
+            packed.insert(packed.end(), &vertex.Normal.x, &vertex.Normal.x + 3);
+            packed.insert(packed.end(), &vertex.TexCoords.x, &vertex.TexCoords.x + 2);
+        }
+        range = arena->add(packed.data(), vertices.size(), indices.data(), indices.size());
+    }
 
-        glBindVertexArray(0);
+    void release() {
+        if (arena != nullptr)
+            arena->release(range);
+        arena = nullptr;
     }
 };
 
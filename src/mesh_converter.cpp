@@ -0,0 +1,672 @@
+//
+// Offline mesh converter: reads Wavefront OBJ and glTF 2.0 (.gltf with embedded or external buffers,
+// or .glb) and writes the binary .mesh format of mesh_file.h, with every mesh reordered for the vertex
+// caches. OBJ groups/objects and glTF primitives each become one mesh; glTF node transforms are baked
+// in. Afterwards the output is mapped back and its load time is compared with plainly reading the file.
+//
+// usage: mesh_converter [--no-optimize] <input.obj|.gltf|.glb> [output.mesh]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "mesh_file.h"
+#include "vertex_cache.h"
+
+namespace fs = std::filesystem;
+
+bool readFile(const fs::path &path, std::string &contents) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+// Smooth normals from the triangles, for sources that don't provide any.
+void generateNormals(MeshData &mesh) {
+    std::vector<glm::vec3> normals(mesh.vertices.size(), glm::vec3(0.0f));
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        glm::vec3 a = glm::make_vec3(mesh.vertices[mesh.indices[i]].position);
+        glm::vec3 b = glm::make_vec3(mesh.vertices[mesh.indices[i + 1]].position);
+        glm::vec3 c = glm::make_vec3(mesh.vertices[mesh.indices[i + 2]].position);
+        // area weighted
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        for (int corner = 0; corner < 3; corner++)
+            normals[mesh.indices[i + corner]] += normal;
+    }
+    for (size_t v = 0; v < normals.size(); v++) {
+        glm::vec3 normal = glm::length(normals[v]) > 0.0f ? glm::normalize(normals[v]) : glm::vec3(0.0f, 1.0f, 0.0f);
+        memcpy(mesh.vertices[v].normal, glm::value_ptr(normal), sizeof(float) * 3);
+    }
+}
+
+//    OBJ
+
+struct ObjCorner {
+    int position, texCoords, normal;
+
+    bool operator==(const ObjCorner &other) const {
+        return position == other.position && texCoords == other.texCoords && normal == other.normal;
+    }
+};
+
+struct ObjCornerHash {
+    size_t operator()(const ObjCorner &corner) const {
+        return ((size_t) corner.position * 73856093) ^ ((size_t) corner.texCoords * 19349663) ^
+               ((size_t) corner.normal * 83492791);
+    }
+};
+
+// Resolves a 1-based (or negative, relative) OBJ index to 0-based; -1 when absent.
+int resolveObjIndex(const std::string &token, size_t count) {
+    if (token.empty())
+        return -1;
+    int index = atoi(token.c_str());
+    return index < 0 ? (int) count + index : index - 1;
+}
+
+bool loadObj(const fs::path &path, std::vector<MeshData> &meshes) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cout << "Failed to open " << path << std::endl;
+        return false;
+    }
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> texCoords;
+    MeshData current;
+    current.name = path.stem().string();
+    std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> corners;
+    bool missingNormals = false;
+
+    auto finish = [&](const std::string &nextName) {
+        if (!current.indices.empty()) {
+            if (missingNormals)
+                generateNormals(current);
+            meshes.push_back(std::move(current));
+        }
+        current = MeshData();
+        current.name = nextName;
+        corners.clear();
+        missingNormals = false;
+    };
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+        if (keyword == "v") {
+            glm::vec3 p;
+            stream >> p.x >> p.y >> p.z;
+            positions.push_back(p);
+        } else if (keyword == "vn") {
+            glm::vec3 n;
+            stream >> n.x >> n.y >> n.z;
+            normals.push_back(n);
+        } else if (keyword == "vt") {
+            glm::vec2 t;
+            stream >> t.x >> t.y;
+            texCoords.push_back(t);
+        } else if (keyword == "o" || keyword == "g") {
+            std::string name;
+            std::getline(stream >> std::ws, name);
+            finish(name.empty() ? current.name : name);
+        } else if (keyword == "f") {
+            std::vector<uint32_t> face;
+            std::string token;
+            while (stream >> token) {
+                // v, v/vt, v//vn or v/vt/vn
+                std::string parts[3];
+                size_t part = 0;
+                for (char c : token) {
+                    if (c == '/')
+                        part = std::min<size_t>(part + 1, 2);
+                    else
+                        parts[part] += c;
+                }
+                ObjCorner corner{resolveObjIndex(parts[0], positions.size()),
+                                 resolveObjIndex(parts[1], texCoords.size()),
+                                 resolveObjIndex(parts[2], normals.size())};
+                if (corner.position < 0 || corner.position >= (int) positions.size() ||
+                    corner.texCoords >= (int) texCoords.size() || corner.normal >= (int) normals.size()) {
+                    std::cout << "Bad face index in " << path << ": " << line << std::endl;
+                    return false;
+                }
+                auto found = corners.find(corner);
+                if (found == corners.end()) {
+                    MeshFileVertex vertex{};
+                    memcpy(vertex.position, glm::value_ptr(positions[corner.position]), sizeof(float) * 3);
+                    if (corner.normal >= 0)
+                        memcpy(vertex.normal, glm::value_ptr(normals[corner.normal]), sizeof(float) * 3);
+                    else
+                        missingNormals = true;
+                    if (corner.texCoords >= 0)
+                        memcpy(vertex.texCoords, glm::value_ptr(texCoords[corner.texCoords]), sizeof(float) * 2);
+                    found = corners.emplace(corner, (uint32_t) current.vertices.size()).first;
+                    current.vertices.push_back(vertex);
+                }
+                face.push_back(found->second);
+            }
+            // polygons as fans
+            for (size_t i = 2; i < face.size(); i++)
+                current.indices.insert(current.indices.end(), {face[0], face[i - 1], face[i]});
+        }
+    }
+    finish("");
+    return true;
+}
+
+//    glTF
+
+// Just enough JSON for glTF: objects, arrays, strings, numbers and literals.
+struct Json {
+    enum Type {
+        NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT
+    } type = NUL;
+    double number = 0.0;
+    std::string string;
+    std::vector<Json> array;
+    std::map<std::string, Json> object;
+
+    const Json &operator[](const std::string &key) const {
+        static const Json missing;
+        auto found = object.find(key);
+        return found == object.end() ? missing : found->second;
+    }
+
+    const Json &operator[](size_t index) const {
+        static const Json missing;
+        return index < array.size() ? array[index] : missing;
+    }
+
+    bool has(const std::string &key) const {
+        return object.count(key) > 0;
+    }
+
+    double numberOr(double fallback) const {
+        return type == NUMBER ? number : fallback;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string &text) : text(text) {}
+
+    bool parse(Json &value) {
+        return parseValue(value) && (skipSpace(), position == text.size());
+    }
+
+private:
+    const std::string &text;
+    size_t position = 0;
+
+    void skipSpace() {
+        while (position < text.size() && isspace((unsigned char) text[position]))
+            position++;
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (position < text.size() && text[position] == c) {
+            position++;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseValue(Json &value) {
+        skipSpace();
+        if (position >= text.size())
+            return false;
+        char c = text[position];
+        if (c == '{') {
+            value.type = Json::OBJECT;
+            position++;
+            if (consume('}'))
+                return true;
+            do {
+                std::string key;
+                skipSpace();
+                if (!parseString(key) || !consume(':') || !parseValue(value.object[key]))
+                    return false;
+            } while (consume(','));
+            return consume('}');
+        }
+        if (c == '[') {
+            value.type = Json::ARRAY;
+            position++;
+            if (consume(']'))
+                return true;
+            do {
+                value.array.emplace_back();
+                if (!parseValue(value.array.back()))
+                    return false;
+            } while (consume(','));
+            return consume(']');
+        }
+        if (c == '"') {
+            value.type = Json::STRING;
+            return parseString(value.string);
+        }
+        for (const char *literal : {"true", "false", "null"})
+            if (text.compare(position, strlen(literal), literal) == 0) {
+                value.type = literal[0] == 'n' ? Json::NUL : Json::BOOLEAN;
+                value.number = literal[0] == 't';
+                position += strlen(literal);
+                return true;
+            }
+        char *end = nullptr;
+        value.number = strtod(text.c_str() + position, &end);
+        if (end == text.c_str() + position)
+            return false;
+        value.type = Json::NUMBER;
+        position = end - text.c_str();
+        return true;
+    }
+
+    bool parseString(std::string &out) {
+        if (position >= text.size() || text[position] != '"')
+            return false;
+        position++;
+        while (position < text.size() && text[position] != '"') {
+            char c = text[position++];
+            if (c == '\\' && position < text.size()) {
+                char escaped = text[position++];
+                switch (escaped) {
+                    case 'n':
+                        out += '\n';
+                        break;
+                    case 't':
+                        out += '\t';
+                        break;
+                    case 'u':
+                        // names and URIs only; non-ASCII code points aren't needed
+                        out += '?';
+                        position += 4;
+                        break;
+                    default:
+                        out += escaped;
+                }
+            } else {
+                out += c;
+            }
+        }
+        return position++ < text.size();
+    }
+};
+
+bool decodeBase64(const std::string &text, std::string &out) {
+    int value = 0, bits = 0;
+    for (char c : text) {
+        int digit;
+        if (c >= 'A' && c <= 'Z')
+            digit = c - 'A';
+        else if (c >= 'a' && c <= 'z')
+            digit = c - 'a' + 26;
+        else if (c >= '0' && c <= '9')
+            digit = c - '0' + 52;
+        else if (c == '+' || c == '-')
+            digit = 62;
+        else if (c == '/' || c == '_')
+            digit = 63;
+        else if (c == '=')
+            break;
+        else
+            return false;
+        value = (value << 6) | digit;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out += (char) ((value >> bits) & 0xFF);
+        }
+    }
+    return true;
+}
+
+struct Gltf {
+    Json json;
+    std::vector<std::string> buffers;
+};
+
+const uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;  // "BIN\0"
+
+bool loadGltfDocument(const fs::path &path, Gltf &gltf) {
+    std::string contents, jsonText, binary;
+    if (!readFile(path, contents)) {
+        std::cout << "Failed to open " << path << std::endl;
+        return false;
+    }
+    uint32_t magic = 0;
+    if (contents.size() >= 12)
+        memcpy(&magic, contents.data(), 4);
+    if (magic == GLB_MAGIC) {
+        for (size_t offset = 12; offset + 8 <= contents.size();) {
+            uint32_t length, type;
+            memcpy(&length, contents.data() + offset, 4);
+            memcpy(&type, contents.data() + offset + 4, 4);
+            if (offset + 8 + length > contents.size())
+                break;
+            if (type == GLB_CHUNK_JSON)
+                jsonText = contents.substr(offset + 8, length);
+            else if (type == GLB_CHUNK_BIN)
+                binary = contents.substr(offset + 8, length);
+            offset += 8 + ((length + 3) & ~3u);
+        }
+    } else {
+        jsonText = contents;
+    }
+    if (!JsonParser(jsonText).parse(gltf.json)) {
+        std::cout << "Failed to parse glTF JSON in " << path << std::endl;
+        return false;
+    }
+    for (const Json &buffer : gltf.json["buffers"].array) {
+        std::string data;
+        const std::string &uri = buffer["uri"].string;
+        if (uri.empty()) {
+            data = binary; // the GLB's own chunk
+        } else if (uri.compare(0, 5, "data:") == 0) {
+            size_t comma = uri.find(',');
+            if (comma == std::string::npos || !decodeBase64(uri.substr(comma + 1), data)) {
+                std::cout << "Unsupported buffer URI in " << path << std::endl;
+                return false;
+            }
+        } else if (!readFile(path.parent_path() / uri, data)) {
+            std::cout << "Failed to open buffer " << uri << std::endl;
+            return false;
+        }
+        gltf.buffers.push_back(std::move(data));
+    }
+    return true;
+}
+
+const int GLTF_FLOAT = 5126;
+const int GLTF_UNSIGNED_BYTE = 5121;
+const int GLTF_UNSIGNED_SHORT = 5123;
+const int GLTF_UNSIGNED_INT = 5125;
+const int GLTF_TRIANGLES = 4;
+
+// Reads component `component` of element `element` of an accessor as a double; false if out of range.
+struct GltfAccessor {
+    const unsigned char *data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    int componentType = 0;
+
+    bool open(const Gltf &gltf, const Json &accessor, int components) {
+        const Json &view = gltf.json["bufferViews"][(size_t) accessor["bufferView"].numberOr(-1)];
+        size_t bufferIndex = (size_t) view["buffer"].numberOr(-1);
+        if (view.type != Json::OBJECT || bufferIndex >= gltf.buffers.size())
+            return false;
+        componentType = (int) accessor["componentType"].number;
+        size_t componentSize = componentType == GLTF_UNSIGNED_BYTE ? 1 : componentType == GLTF_UNSIGNED_SHORT ? 2 : 4;
+        count = (size_t) accessor["count"].number;
+        stride = (size_t) view["byteStride"].numberOr((double) (componentSize * components));
+        size_t offset = (size_t) (view["byteOffset"].numberOr(0) + accessor["byteOffset"].numberOr(0));
+        const std::string &buffer = gltf.buffers[bufferIndex];
+        if (count > 0 && offset + (count - 1) * stride + componentSize * components > buffer.size())
+            return false;
+        data = (const unsigned char *) buffer.data() + offset;
+        return true;
+    }
+
+    float floatAt(size_t element, int component) const {
+        float value;
+        memcpy(&value, data + element * stride + component * 4, 4);
+        return value;
+    }
+
+    uint32_t indexAt(size_t element) const {
+        const unsigned char *p = data + element * stride;
+        if (componentType == GLTF_UNSIGNED_BYTE)
+            return *p;
+        if (componentType == GLTF_UNSIGNED_SHORT) {
+            uint16_t value;
+            memcpy(&value, p, 2);
+            return value;
+        }
+        uint32_t value;
+        memcpy(&value, p, 4);
+        return value;
+    }
+};
+
+glm::mat4 gltfNodeTransform(const Json &node) {
+    if (node["matrix"].array.size() == 16) {
+        glm::mat4 matrix;
+        for (int i = 0; i < 16; i++)
+            glm::value_ptr(matrix)[i] = (float) node["matrix"][i].number;
+        return matrix;
+    }
+    glm::vec3 translation(0.0f), scale(1.0f);
+    glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+    if (node.has("translation"))
+        translation = glm::vec3(node["translation"][0].number, node["translation"][1].number,
+                                node["translation"][2].number);
+    if (node.has("rotation"))
+        rotation = glm::quat((float) node["rotation"][3].number, (float) node["rotation"][0].number,
+                             (float) node["rotation"][1].number, (float) node["rotation"][2].number);
+    if (node.has("scale"))
+        scale = glm::vec3(node["scale"][0].number, node["scale"][1].number, node["scale"][2].number);
+    return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) *
+           glm::scale(glm::mat4(1.0f), scale);
+}
+
+bool convertGltfPrimitive(const Gltf &gltf, const Json &primitive, const glm::mat4 &transform, MeshData &mesh) {
+    if ((int) primitive["mode"].numberOr(GLTF_TRIANGLES) != GLTF_TRIANGLES) {
+        std::cout << "Skipping " << mesh.name << ": only triangle lists are supported" << std::endl;
+        return false;
+    }
+    const Json &attributes = primitive["attributes"];
+    const Json &accessors = gltf.json["accessors"];
+    GltfAccessor positions, normals, texCoords, indices;
+    if (!positions.open(gltf, accessors[(size_t) attributes["POSITION"].numberOr(-1)], 3) ||
+        positions.componentType != GLTF_FLOAT) {
+        std::cout << "Skipping " << mesh.name << ": missing or unsupported positions" << std::endl;
+        return false;
+    }
+    bool hasNormals = attributes.has("NORMAL") &&
+                      normals.open(gltf, accessors[(size_t) attributes["NORMAL"].number], 3) &&
+                      normals.componentType == GLTF_FLOAT && normals.count == positions.count;
+    bool hasTexCoords = attributes.has("TEXCOORD_0") &&
+                        texCoords.open(gltf, accessors[(size_t) attributes["TEXCOORD_0"].number], 2) &&
+                        texCoords.componentType == GLTF_FLOAT && texCoords.count == positions.count;
+
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+    mesh.vertices.resize(positions.count);
+    for (size_t v = 0; v < positions.count; v++) {
+        MeshFileVertex &vertex = mesh.vertices[v];
+        glm::vec3 p = glm::vec3(transform * glm::vec4(positions.floatAt(v, 0), positions.floatAt(v, 1),
+                                                      positions.floatAt(v, 2), 1.0f));
+        memcpy(vertex.position, glm::value_ptr(p), sizeof(float) * 3);
+        if (hasNormals) {
+            glm::vec3 n = glm::normalize(normalMatrix * glm::vec3(normals.floatAt(v, 0), normals.floatAt(v, 1),
+                                                                  normals.floatAt(v, 2)));
+            memcpy(vertex.normal, glm::value_ptr(n), sizeof(float) * 3);
+        }
+        if (hasTexCoords) {
+            vertex.texCoords[0] = texCoords.floatAt(v, 0);
+            vertex.texCoords[1] = texCoords.floatAt(v, 1);
+        }
+    }
+
+    if (primitive.has("indices")) {
+        if (!indices.open(gltf, accessors[(size_t) primitive["indices"].number], 1)) {
+            std::cout << "Skipping " << mesh.name << ": bad index accessor" << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i + 2 < indices.count; i += 3)
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t index = indices.indexAt(i + corner);
+                if (index >= positions.count) {
+                    std::cout << "Skipping " << mesh.name << ": index out of range" << std::endl;
+                    return false;
+                }
+                mesh.indices.push_back(index);
+            }
+    } else {
+        for (uint32_t i = 0; i + 2 < positions.count; i += 3)
+            mesh.indices.insert(mesh.indices.end(), {i, i + 1, i + 2});
+    }
+    // mirroring transforms flip the winding
+    if (glm::determinant(glm::mat3(transform)) < 0.0f)
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+            std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+    if (!hasNormals)
+        generateNormals(mesh);
+    return true;
+}
+
+void convertGltfNode(const Gltf &gltf, size_t nodeIndex, const glm::mat4 &parent, std::vector<MeshData> &meshes,
+                     int depth) {
+    const Json &node = gltf.json["nodes"][nodeIndex];
+    // guards against cyclic hierarchies in broken files
+    if (node.type != Json::OBJECT || depth > 64)
+        return;
+    glm::mat4 transform = parent * gltfNodeTransform(node);
+    if (node.has("mesh")) {
+        const Json &mesh = gltf.json["meshes"][(size_t) node["mesh"].number];
+        std::string name = mesh["name"].string.empty() ? "mesh" + std::to_string((size_t) node["mesh"].number)
+                                                       : mesh["name"].string;
+        for (size_t p = 0; p < mesh["primitives"].array.size(); p++) {
+            MeshData data;
+            data.name = mesh["primitives"].array.size() > 1 ? name + "." + std::to_string(p) : name;
+            if (convertGltfPrimitive(gltf, mesh["primitives"][p], transform, data))
+                meshes.push_back(std::move(data));
+        }
+    }
+    for (const Json &child : node["children"].array)
+        convertGltfNode(gltf, (size_t) child.number, transform, meshes, depth + 1);
+}
+
+bool loadGltf(const fs::path &path, std::vector<MeshData> &meshes) {
+    Gltf gltf;
+    if (!loadGltfDocument(path, gltf))
+        return false;
+    const Json &scenes = gltf.json["scenes"];
+    if (scenes.array.empty()) {
+        // no scene: every node counts as a root
+        for (size_t node = 0; node < gltf.json["nodes"].array.size(); node++)
+            convertGltfNode(gltf, node, glm::mat4(1.0f), meshes, 0);
+    } else {
+        const Json &scene = scenes[(size_t) gltf.json["scene"].numberOr(0)];
+        for (const Json &node : scene["nodes"].array)
+            convertGltfNode(gltf, (size_t) node.number, glm::mat4(1.0f), meshes, 0);
+    }
+    return true;
+}
+
+//    MAIN
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Maps the written file the way the renderer does, touching every page, and compares the time with
+// reading it into memory.
+void reportLoadTime(const fs::path &path) {
+    auto start = std::chrono::steady_clock::now();
+    size_t touched = 0;
+    {
+        MeshFile file(path.string());
+        for (uint32_t mesh = 0; mesh < file.meshCount(); mesh++) {
+            const MeshFileEntry &entry = file.entry(mesh);
+            const auto *vertices = (const unsigned char *) file.vertices(mesh);
+            const auto *indices = (const unsigned char *) file.indices(mesh);
+            for (size_t offset = 0; offset < entry.vertexCount * sizeof(MeshFileVertex); offset += 4096)
+                touched += vertices[offset];
+            for (size_t offset = 0; offset < entry.indexCount * sizeof(uint32_t); offset += 4096)
+                touched += indices[offset];
+        }
+    }
+    double mappedMs = elapsedMs(start);
+    start = std::chrono::steady_clock::now();
+    std::string contents;
+    readFile(path, contents);
+    double readMs = elapsedMs(start);
+    volatile size_t sink = touched + contents.size();
+    (void) sink;
+    std::cout << "Mapped and validated in " << mappedMs << " ms; reading the file takes " << readMs << " ms"
+              << std::endl;
+}
+
+int main(int argc, char **argv) {
+    bool optimize = true;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-optimize") == 0)
+            optimize = false;
+        else
+            paths.emplace_back(argv[i]);
+    }
+    if (paths.empty() || paths.size() > 2) {
+        std::cout << "usage: mesh_converter [--no-optimize] <input.obj|.gltf|.glb> [output.mesh]" << std::endl;
+        return 1;
+    }
+    fs::path input = paths[0];
+    fs::path output = paths.size() > 1 ? fs::path(paths[1]) : fs::path(input).replace_extension(".mesh");
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<MeshData> meshes;
+    std::string extension = input.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    bool loaded;
+    if (extension == ".obj") {
+        loaded = loadObj(input, meshes);
+    } else if (extension == ".gltf" || extension == ".glb") {
+        loaded = loadGltf(input, meshes);
+    } else {
+        std::cout << "Unsupported input format: " << input << std::endl;
+        return 1;
+    }
+    if (!loaded || meshes.empty()) {
+        std::cout << "No meshes found in " << input << std::endl;
+        return 1;
+    }
+    double parseMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    size_t triangles = 0;
+    double acmrBefore = 0.0, acmrAfter = 0.0;
+    for (auto &mesh : meshes) {
+        triangles += mesh.indices.size() / 3;
+        acmrBefore += vertexCacheMissRatio(mesh.indices) * (mesh.indices.size() / 3);
+        if (optimize) {
+            optimizeVertexCache(mesh.indices);
+            optimizeVertexFetch(mesh.vertices, mesh.indices);
+        }
+        acmrAfter += vertexCacheMissRatio(mesh.indices) * (mesh.indices.size() / 3);
+    }
+    double optimizeMs = elapsedMs(start);
+
+    if (!writeMeshFile(output.string(), meshes))
+        return 1;
+    std::cout << input.string() << " -> " << output.string() << ": " << meshes.size() << " meshes, " << triangles
+              << " triangles, " << fs::file_size(output) << " bytes" << std::endl;
+    std::cout << "Parsed in " << parseMs << " ms, optimized in " << optimizeMs << " ms, ACMR "
+              << acmrBefore / std::max<size_t>(1, triangles) << " -> " << acmrAfter / std::max<size_t>(1, triangles)
+              << std::endl;
+    reportLoadTime(output);
+    return 0;
+}
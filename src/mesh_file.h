@@ -0,0 +1,212 @@
+//
+// Binary mesh files (.mesh), written offline by mesh_converter from OBJ and glTF. A header and a table
+// of contents are followed by one vertex blob and one index blob, each aligned to MESH_FILE_ALIGNMENT
+// and already in the form the GPU wants: MeshFileVertex matches MESH_COMPACT_VERTEX_LAYOUT, indices are
+// 32-bit and relative to their mesh's first vertex, and both were reordered for the vertex caches when
+// the file was written. Loading is a memory map and one upload per mesh straight from the mapping;
+// nothing is parsed or copied on the CPU.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_MESH_FILE_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_MESH_FILE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "geometry_arena.h"
+#include "mapped_file.h"
+
+const uint32_t MESH_FILE_MAGIC = 0x4853454D; // "MESH"
+const uint32_t MESH_FILE_VERSION = 1;
+const uint64_t MESH_FILE_ALIGNMENT = 64;
+
+struct MeshFileVertex {
+    float position[3];
+    float normal[3];
+    float texCoords[2];
+};
+
+static_assert(sizeof(MeshFileVertex) == 32, "MeshFileVertex must match MESH_COMPACT_VERTEX_LAYOUT");
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t meshCount;  // entries in the table of contents, which follows the header
+    uint32_t vertexSize; // sizeof(MeshFileVertex) when written
+    uint64_t vertexOffset; // vertex blob, in bytes from the start of the file
+    uint64_t vertexBytes;
+    uint64_t indexOffset;  // index blob (uint32_t)
+    uint64_t indexBytes;
+};
+
+// Where one mesh lives in the blobs, in vertices and indices, with its object-space bounds.
+struct MeshFileEntry {
+    char name[64];
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float min[3];
+    float max[3];
+};
+
+// A mesh as the converter builds it before writing.
+struct MeshData {
+    std::string name;
+    std::vector<MeshFileVertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+inline uint64_t alignMeshFileOffset(uint64_t offset) {
+    return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+}
+
+bool writeMeshFile(const std::string &path, const std::vector<MeshData> &meshes) {
+    MeshFileHeader header{};
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.meshCount = (uint32_t) meshes.size();
+    header.vertexSize = sizeof(MeshFileVertex);
+    std::vector<MeshFileEntry> entries;
+    uint64_t vertexCount = 0, indexCount = 0;
+    for (const auto &mesh : meshes) {
+        MeshFileEntry entry{};
+        strncpy(entry.name, mesh.name.c_str(), sizeof(entry.name) - 1);
+        entry.firstVertex = (uint32_t) vertexCount;
+        entry.vertexCount = (uint32_t) mesh.vertices.size();
+        entry.firstIndex = (uint32_t) indexCount;
+        entry.indexCount = (uint32_t) mesh.indices.size();
+        for (int axis = 0; axis < 3; axis++) {
+            entry.min[axis] = mesh.vertices.empty() ? 0.0f : 1e30f;
+            entry.max[axis] = mesh.vertices.empty() ? 0.0f : -1e30f;
+        }
+        for (const auto &vertex : mesh.vertices)
+            for (int axis = 0; axis < 3; axis++) {
+                entry.min[axis] = std::min(entry.min[axis], vertex.position[axis]);
+                entry.max[axis] = std::max(entry.max[axis], vertex.position[axis]);
+            }
+        entries.push_back(entry);
+        vertexCount += mesh.vertices.size();
+        indexCount += mesh.indices.size();
+    }
+    header.vertexOffset = alignMeshFileOffset(sizeof(header) + entries.size() * sizeof(MeshFileEntry));
+    header.vertexBytes = vertexCount * sizeof(MeshFileVertex);
+    header.indexOffset = alignMeshFileOffset(header.vertexOffset + header.vertexBytes);
+    header.indexBytes = indexCount * sizeof(uint32_t);
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cout << "Failed to write mesh file " << path << std::endl;
+        return false;
+    }
+    auto pad = [&](uint64_t offset) {
+        static const char zeros[MESH_FILE_ALIGNMENT] = {};
+        out.write(zeros, offset - (uint64_t) out.tellp());
+    };
+    out.write((const char *) &header, sizeof(header));
+    out.write((const char *) entries.data(), entries.size() * sizeof(MeshFileEntry));
+    pad(header.vertexOffset);
+    for (const auto &mesh : meshes)
+        out.write((const char *) mesh.vertices.data(), mesh.vertices.size() * sizeof(MeshFileVertex));
+    pad(header.indexOffset);
+    for (const auto &mesh : meshes)
+        out.write((const char *) mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    return (bool) out;
+}
+
+// A mapped .mesh file. Everything is checked once when it's opened, down to every index lying within its
+// mesh's vertices, so a corrupt file can't make the GPU fetch past the arena's vertex buffer.
+class MeshFile {
+public:
+    explicit MeshFile(const std::string &path) : file(path) {
+        if (!file.isOpen()) {
+            std::cout << "Failed to open mesh file " << path << std::endl;
+            return;
+        }
+        if (!validate()) {
+            std::cout << "Invalid mesh file " << path << std::endl;
+            return;
+        }
+        valid = true;
+    }
+
+    bool isOpen() const {
+        return valid;
+    }
+
+    uint32_t meshCount() const {
+        return valid ? header()->meshCount : 0;
+    }
+
+    const MeshFileEntry &entry(uint32_t mesh) const {
+        return entries()[mesh];
+    }
+
+    const MeshFileVertex *vertices(uint32_t mesh) const {
+        return (const MeshFileVertex *) (file.data() + header()->vertexOffset) + entry(mesh).firstVertex;
+    }
+
+    const uint32_t *indices(uint32_t mesh) const {
+        return (const uint32_t *) (file.data() + header()->indexOffset) + entry(mesh).firstIndex;
+    }
+
+    // Uploads one mesh from the mapping into an arena with MESH_COMPACT_VERTEX_LAYOUT.
+    GeometryRange upload(uint32_t mesh, GeometryArena &arena) const {
+        if (arena.vertexSize() != (GLsizei) sizeof(MeshFileVertex)) {
+            std::cout << "Mesh file vertices don't match the arena's layout" << std::endl;
+            return GeometryRange();
+        }
+        const MeshFileEntry &meshEntry = entry(mesh);
+        return arena.add(vertices(mesh), meshEntry.vertexCount, indices(mesh), meshEntry.indexCount);
+    }
+
+private:
+    MappedFile file;
+    bool valid = false;
+
+    const MeshFileHeader *header() const {
+        return (const MeshFileHeader *) file.data();
+    }
+
+    const MeshFileEntry *entries() const {
+        return (const MeshFileEntry *) (file.data() + sizeof(MeshFileHeader));
+    }
+
+    bool validate() const {
+        if (file.size() < sizeof(MeshFileHeader))
+            return false;
+        const MeshFileHeader *h = header();
+        if (h->magic != MESH_FILE_MAGIC || h->version != MESH_FILE_VERSION || h->vertexSize != sizeof(MeshFileVertex))
+            return false;
+        if (sizeof(MeshFileHeader) + (uint64_t) h->meshCount * sizeof(MeshFileEntry) > file.size() ||
+            h->vertexOffset % MESH_FILE_ALIGNMENT != 0 || h->indexOffset % MESH_FILE_ALIGNMENT != 0 ||
+            !inFile(h->vertexOffset, h->vertexBytes) || !inFile(h->indexOffset, h->indexBytes) ||
+            h->vertexBytes % sizeof(MeshFileVertex) != 0 || h->indexBytes % sizeof(uint32_t) != 0)
+            return false;
+        uint64_t vertexCount = h->vertexBytes / sizeof(MeshFileVertex), indexCount = h->indexBytes / sizeof(uint32_t);
+        for (uint32_t mesh = 0; mesh < h->meshCount; mesh++) {
+            const MeshFileEntry &e = entries()[mesh];
+            if ((uint64_t) e.firstVertex + e.vertexCount > vertexCount ||
+                (uint64_t) e.firstIndex + e.indexCount > indexCount)
+                return false;
+            // upload() adds the base vertex unchecked, so an index past the mesh would read past the arena
+            const uint32_t *meshIndices = indices(mesh);
+            for (uint32_t i = 0; i < e.indexCount; i++)
+                if (meshIndices[i] >= e.vertexCount)
+                    return false;
+        }
+        return true;
+    }
+
+    // Whether [offset, offset + bytes) lies within the file, without the sum wrapping.
+    bool inFile(uint64_t offset, uint64_t bytes) const {
+        return offset <= file.size() && bytes <= file.size() - offset;
+    }
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_MESH_FILE_H
@@ -0,0 +1,409 @@
+//
+// Tessendorf-style FFT ocean. A Phillips spectrum is built once; every update it's advanced to the
+// requested time and turned into a tileable displacement map (choppy x/z offsets and height) and a
+// normal map with inverse FFTs, which the water shaders sample. Wave detail depends on the spectrum
+// resolution, not on the water mesh.
+//
+// The FFTs run on worker threads while the render loop keeps going; a finished update is uploaded on
+// the next call to update(). Transforms are kept as separate real and imaginary planes and the
+// butterflies combine whole rows at a time, so every inner loop walks contiguous floats and is
+// vectorized by the compiler. Real outputs are packed in pairs, real + i * real, so the five fields
+// need three complex transforms.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_OCEAN_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_OCEAN_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "gl_resources.h"
+
+struct OceanConfig {
+    int resolution = 128;     // spectrum samples per side, a power of two
+    float patchSize = 50.0f;  // world units covered by one tile of the maps
+    float updateRate = 30.0f; // spectrum updates per second of simulation time
+    float windSpeed = 6.0f;
+    glm::vec2 windDirection = glm::vec2(1.0f, 0.6f);
+    float amplitude = 0.00002f;
+    float choppiness = 1.2f;
+    int threads = 1;
+};
+
+class Ocean {
+public:
+    OceanConfig config;
+    GLTexture displacementMap; // RGB: x offset, height, z offset
+    GLTexture normalMap;
+    // wait for each update instead of overlapping it with rendering, for reproducible benchmarks
+    bool synchronous = false;
+
+    Ocean(const OceanConfig &config, unsigned int seed) : config(config), seed(seed) {}
+
+    Ocean(const Ocean &) = delete;
+    Ocean &operator=(const Ocean &) = delete;
+
+    ~Ocean() {
+        stopWorkers();
+    }
+
+    // Call once the context is current. Builds the spectrum, starts the workers and fills the maps for time 0.
+    bool init() {
+        int n = config.resolution;
+        if (n < 4 || (n & (n - 1)) != 0) {
+            std::cout << "Ocean resolution must be a power of two, got " << n << std::endl;
+            return false;
+        }
+        createSpectrum();
+        createTwiddles();
+        for (auto &transform : transforms) {
+            transform.re.assign((size_t) n * n, 0.0f);
+            transform.im.assign((size_t) n * n, 0.0f);
+        }
+        displacement.assign((size_t) n * n * 3, 0.0f);
+        normals.assign((size_t) n * n * 3, 0.0f);
+
+        createMap(displacementMap, false);
+        createMap(normalMap, true);
+
+        int threads = std::max(1, std::min(config.threads, TRANSFORMS));
+        for (int i = 0; i < threads; i++)
+            workers.emplace_back([this] { workerLoop(); });
+
+        bool wasSynchronous = synchronous;
+        synchronous = true;
+        update(0.0);
+        synchronous = wasSynchronous;
+        return true;
+    }
+
+    // Uploads a finished update and starts the next one when it's due.
+    void update(double time) {
+        if (busy && synchronous)
+            waitForResult();
+        if (busy && ready.load(std::memory_order_acquire)) {
+            upload();
+            busy = false;
+        }
+        if (!busy && time >= nextUpdate) {
+            nextUpdate = time + 1.0 / config.updateRate;
+            launch(time);
+            if (synchronous) {
+                waitForResult();
+                upload();
+                busy = false;
+            }
+        }
+    }
+
+    void stopWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        start.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+        workers.clear();
+    }
+
+private:
+    static const int TRANSFORMS = 3;
+    static constexpr float GRAVITY = 9.81f;
+
+    struct Plane {
+        std::vector<float> re;
+        std::vector<float> im;
+    };
+
+    unsigned int seed;
+    std::vector<float> h0Re, h0Im;     // h0(k)
+    std::vector<float> h0cRe, h0cIm;   // conj(h0(-k))
+    std::vector<float> omega;          // dispersion, sqrt(g |k|)
+    std::vector<float> twiddleRe, twiddleIm;
+    std::vector<int> bitReverse;
+    Plane transforms[TRANSFORMS];      // h + i dx, dz + i sx, sz
+    std::vector<float> displacement;
+    std::vector<float> normals;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable done;
+    bool stop = false;
+    uint32_t generation = 0;
+    double requestTime = 0.0;
+    // generation in the high 32 bits, next unclaimed transform in the low ones, so a worker still
+    // finishing the previous update can't claim (and evaluate at its stale time) a task of this one
+    std::atomic<uint64_t> nextTask{0};
+    std::atomic<int> remaining{0};
+    std::atomic<bool> ready{false};
+    bool busy = false;
+    double nextUpdate = 0.0;
+
+    float waveNumber(int i) const {
+        return glm::two_pi<float>() * (i - config.resolution / 2) / config.patchSize;
+    }
+
+    void createSpectrum() {
+        int n = config.resolution;
+        std::mt19937 random(seed);
+        std::normal_distribution<float> gaussian(0.0f, 1.0f);
+        glm::vec2 wind = glm::normalize(config.windDirection);
+        float largest = config.windSpeed * config.windSpeed / GRAVITY;
+        float smallest = largest / 1000.0f;
+
+        auto phillips = [&](glm::vec2 k) {
+            float length2 = glm::dot(k, k);
+            if (length2 < 1e-12f)
+                return 0.0f;
+            float cosine = glm::dot(k / std::sqrt(length2), wind);
+            return config.amplitude * std::exp(-1.0f / (length2 * largest * largest)) / (length2 * length2) *
+                   cosine * cosine * std::exp(-length2 * smallest * smallest);
+        };
+
+        std::vector<float> re((size_t) n * n), im((size_t) n * n);
+        omega.resize((size_t) n * n);
+        for (int z = 0; z < n; z++)
+            for (int x = 0; x < n; x++) {
+                glm::vec2 k(waveNumber(x), waveNumber(z));
+                // the Nyquist row and column have no mirrored partner; leaving them empty keeps every
+                // field's spectrum exactly Hermitian, so the packed transforms separate cleanly
+                float amplitude = x == 0 || z == 0 ? 0.0f : std::sqrt(phillips(k) / 2.0f);
+                re[z * n + x] = gaussian(random) * amplitude;
+                im[z * n + x] = gaussian(random) * amplitude;
+                omega[z * n + x] = std::sqrt(GRAVITY * glm::length(k));
+            }
+
+        h0Re = re;
+        h0Im = im;
+        h0cRe.resize(re.size());
+        h0cIm.resize(im.size());
+        for (int z = 0; z < n; z++)
+            for (int x = 0; x < n; x++) {
+                int mirrored = ((n - z) % n) * n + (n - x) % n;
+                h0cRe[z * n + x] = re[mirrored];
+                h0cIm[z * n + x] = -im[mirrored];
+            }
+    }
+
+    void createTwiddles() {
+        int n = config.resolution;
+        twiddleRe.resize(n / 2);
+        twiddleIm.resize(n / 2);
+        for (int i = 0; i < n / 2; i++) {
+            // inverse transform, e^(+2 pi i k / n)
+            twiddleRe[i] = std::cos(glm::two_pi<double>() * i / n);
+            twiddleIm[i] = std::sin(glm::two_pi<double>() * i / n);
+        }
+        int bits = 0;
+        while ((1 << bits) < n)
+            bits++;
+        bitReverse.resize(n);
+        for (int i = 0; i < n; i++) {
+            int reversed = 0;
+            for (int b = 0; b < bits; b++)
+                if (i & (1 << b))
+                    reversed |= 1 << (bits - 1 - b);
+            bitReverse[i] = reversed;
+        }
+    }
+
+    void createMap(GLTexture &texture, bool mipmapped) {
+        texture.create();
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, config.resolution, config.resolution, 0, GL_RGB, GL_FLOAT, nullptr);
+        // a full mip chain adds a third
+        long long bytes = (long long) config.resolution * config.resolution * 8;
+        texture.setBytes(mipmapped ? bytes * 4 / 3 : bytes);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void launch(double time) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requestTime = time;
+            ready.store(false, std::memory_order_relaxed);
+            generation++;
+            nextTask.store((uint64_t) generation << 32, std::memory_order_relaxed);
+            remaining.store(TRANSFORMS, std::memory_order_relaxed);
+        }
+        busy = true;
+        start.notify_all();
+    }
+
+    void waitForResult() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return ready.load(std::memory_order_acquire); });
+    }
+
+    void upload() {
+        int n = config.resolution;
+        glBindTexture(GL_TEXTURE_2D, displacementMap);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RGB, GL_FLOAT, displacement.data());
+        glBindTexture(GL_TEXTURE_2D, normalMap);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RGB, GL_FLOAT, normals.data());
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void workerLoop() {
+        uint32_t seen = 0;
+        while (true) {
+            double time;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start.wait(lock, [&] { return stop || generation != seen; });
+                if (stop)
+                    return;
+                seen = generation;
+                time = requestTime;
+            }
+            int task;
+            while ((task = claimTask(seen)) >= 0) {
+                evaluate(task, (float) time);
+                inverseFft(transforms[task]);
+                if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    // last one out combines the results
+                    assemble();
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        ready.store(true, std::memory_order_release);
+                    }
+                    done.notify_all();
+                }
+            }
+        }
+    }
+
+    // Next transform of update `seen`, or -1 once they're all taken or a newer update has started.
+    int claimTask(uint32_t seen) {
+        uint64_t claim = nextTask.load(std::memory_order_relaxed);
+        do {
+            if ((uint32_t) (claim >> 32) != seen || (int) (uint32_t) claim >= TRANSFORMS)
+                return -1;
+        } while (!nextTask.compare_exchange_weak(claim, claim + 1, std::memory_order_relaxed));
+        return (int) (uint32_t) claim;
+    }
+
+    // Fills transform `task` with the spectrum at `time`, multiplied into the two fields it carries.
+    void evaluate(int task, float time) {
+        int n = config.resolution;
+        Plane &out = transforms[task];
+        for (int z = 0; z < n; z++) {
+            float kz = waveNumber(z);
+            for (int x = 0; x < n; x++) {
+                int i = z * n + x;
+                float kx = waveNumber(x);
+                float c = std::cos(omega[i] * time), s = std::sin(omega[i] * time);
+                // h(k, t) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t)
+                float hRe = (h0Re[i] + h0cRe[i]) * c - (h0Im[i] - h0cIm[i]) * s;
+                float hIm = (h0Re[i] - h0cRe[i]) * s + (h0Im[i] + h0cIm[i]) * c;
+                float k = std::sqrt(kx * kx + kz * kz);
+                float ux = k > 0.0f ? kx / k : 0.0f, uz = k > 0.0f ? kz / k : 0.0f;
+
+                // multiplying by i a: (re, im) -> (-a im, a re); each field's spectrum is Hermitian, so
+                // field A + i field B transforms to a + i b with both a and b real
+                float aRe, aIm, bRe, bIm;
+                if (task == 0) {        // height, x displacement (-i kx/k h)
+                    aRe = hRe, aIm = hIm;
+                    bRe = ux * hIm, bIm = -ux * hRe;
+                } else if (task == 1) { // z displacement, x slope (i kx h)
+                    aRe = uz * hIm, aIm = -uz * hRe;
+                    bRe = -kx * hIm, bIm = kx * hRe;
+                } else {                // z slope
+                    aRe = -kz * hIm, aIm = kz * hRe;
+                    bRe = 0.0f, bIm = 0.0f;
+                }
+                out.re[i] = aRe - bIm;
+                out.im[i] = aIm + bRe;
+            }
+        }
+    }
+
+    // 2D inverse FFT: columns, transpose, columns, transpose.
+    void inverseFft(Plane &plane) {
+        inverseColumns(plane);
+        transpose(plane);
+        inverseColumns(plane);
+        transpose(plane);
+    }
+
+    // Radix-2 inverse FFT of every column at once. Butterflies combine two whole rows, so the inner
+    // loop runs over n contiguous floats per plane.
+    void inverseColumns(Plane &plane) {
+        int n = config.resolution;
+        float *re = plane.re.data(), *im = plane.im.data();
+        for (int i = 0; i < n; i++) {
+            int j = bitReverse[i];
+            if (i < j) {
+                std::swap_ranges(re + (size_t) i * n, re + (size_t) (i + 1) * n, re + (size_t) j * n);
+                std::swap_ranges(im + (size_t) i * n, im + (size_t) (i + 1) * n, im + (size_t) j * n);
+            }
+        }
+        for (int size = 2; size <= n; size *= 2) {
+            int half = size / 2, step = n / size;
+            for (int first = 0; first < n; first += size)
+                for (int j = 0; j < half; j++) {
+                    float wRe = twiddleRe[j * step], wIm = twiddleIm[j * step];
+                    float *__restrict aRe = re + (size_t) (first + j) * n;
+                    float *__restrict aIm = im + (size_t) (first + j) * n;
+                    float *__restrict bRe = re + (size_t) (first + j + half) * n;
+                    float *__restrict bIm = im + (size_t) (first + j + half) * n;
+                    for (int c = 0; c < n; c++) {
+                        float tRe = wRe * bRe[c] - wIm * bIm[c];
+                        float tIm = wRe * bIm[c] + wIm * bRe[c];
+                        bRe[c] = aRe[c] - tRe;
+                        bIm[c] = aIm[c] - tIm;
+                        aRe[c] += tRe;
+                        aIm[c] += tIm;
+                    }
+                }
+        }
+    }
+
+    void transpose(Plane &plane) {
+        int n = config.resolution;
+        for (int z = 0; z < n; z++)
+            for (int x = z + 1; x < n; x++) {
+                std::swap(plane.re[(size_t) z * n + x], plane.re[(size_t) x * n + z]);
+                std::swap(plane.im[(size_t) z * n + x], plane.im[(size_t) x * n + z]);
+            }
+    }
+
+    void assemble() {
+        int n = config.resolution;
+        const Plane &first = transforms[0], &second = transforms[1], &third = transforms[2];
+        for (int z = 0; z < n; z++)
+            for (int x = 0; x < n; x++) {
+                size_t i = (size_t) z * n + x;
+                // the spectrum is centered on k = 0, which shifts every output by (-1)^(x + z)
+                float sign = ((x + z) & 1) ? -1.0f : 1.0f;
+                displacement[i * 3] = first.im[i] * sign * config.choppiness;
+                displacement[i * 3 + 1] = first.re[i] * sign;
+                displacement[i * 3 + 2] = second.re[i] * sign * config.choppiness;
+                glm::vec3 normal = glm::normalize(glm::vec3(-second.im[i] * sign, 1.0f, -third.re[i] * sign));
+                normals[i * 3] = normal.x;
+                normals[i * 3 + 1] = normal.y;
+                normals[i * 3 + 2] = normal.z;
+            }
+    }
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_OCEAN_H
@@ -1,3 +1,9 @@
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <vector>
+
 double fade(double t) { return t * t * t * (t * (t * 6 - 15) + 10); };
 
 double lerp(double t, double a, double b) { return a + t * (b - a); }
@@ -34,9 +40,16 @@ double perlin_noise(float x, float y, std::vector<int> &p) {
                           grad(p[BB + 1], x - 1, y - 1, z - 1))));
 }
 
+// seeds the terrain; benchmarks fix it so every run sees the same world
+unsigned int worldSeed = (unsigned int) time(NULL);
+// srand/rand state is global: whoever reseeds from worldSeed holds this until done drawing, so terrain
+// generated on several threads at once still sees the single-threaded sequence
+std::mutex worldSeedMutex;
+
 std::vector<int> createPermutation() {
     std::vector<int> p;
-    srand((unsigned int) time(NULL));
+    std::lock_guard<std::mutex> lock(worldSeedMutex);
+    srand(worldSeed);
     for (int i = 0; i < 256; i++) {
         int a = rand() % 256;
         p.push_back(a);
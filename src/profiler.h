@@ -0,0 +1,271 @@
+//
+// Per-pass frame profiler. Named scopes record CPU time directly and GPU time with a pair of
+// GL_TIMESTAMP queries. Query results are read back FRAME_LATENCY frames later, when the GPU has
+// long finished with them, so profiling never stalls the pipeline. Each pass keeps a rolling window
+// of samples from which min/avg/p99 are computed; everything can be dumped to CSV or JSON.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_PROFILER_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_PROFILER_H
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+class Profiler {
+public:
+    static const int FRAME_LATENCY = 3; // query sets in flight
+    static const int HISTORY = 300;     // samples kept per pass
+
+    struct Stats {
+        int samples = 0;
+        double min = 0.0;
+        double avg = 0.0;
+        double p99 = 0.0;
+    };
+
+    bool gpuTiming = true;
+
+    // Call once per frame, before the first scope. Collects the GPU results that are now ready.
+    void beginFrame() {
+        frame = (frame + 1) % FRAME_LATENCY;
+        for (const auto &pending : frames[frame]) {
+            GLint available = 0;
+            glGetQueryObjectiv(pending.end, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 start = 0, end = 0;
+                glGetQueryObjectui64v(pending.start, GL_QUERY_RESULT, &start);
+                glGetQueryObjectui64v(pending.end, GL_QUERY_RESULT, &end);
+                passes[pending.pass].gpu.add((end - start) / 1e6);
+            }
+            // a result that still isn't there is dropped rather than waited for
+            freeQueries.push_back(pending.start);
+            freeQueries.push_back(pending.end);
+        }
+        frames[frame].clear();
+    }
+
+    void begin(const std::string &name) {
+        OpenScope scope;
+        scope.pass = passIndex(name);
+        scope.cpuStart = std::chrono::steady_clock::now();
+        if (gpuTiming) {
+            scope.query = acquireQuery();
+            glQueryCounter(scope.query, GL_TIMESTAMP);
+        }
+        open.push_back(scope);
+    }
+
+    void end() {
+        if (open.empty()) {
+            std::cout << "Profiler::end called without a matching begin" << std::endl;
+            return;
+        }
+        OpenScope scope = open.back();
+        open.pop_back();
+
+        auto elapsed = std::chrono::steady_clock::now() - scope.cpuStart;
+        passes[scope.pass].cpu.add(std::chrono::duration<double, std::milli>(elapsed).count());
+        if (scope.query != 0) {
+            unsigned int query = acquireQuery();
+            glQueryCounter(query, GL_TIMESTAMP);
+            frames[frame].push_back({scope.pass, scope.query, query});
+        }
+    }
+
+    Stats cpuStats(const std::string &name) const {
+        auto it = index.find(name);
+        return it == index.end() ? Stats() : passes[it->second].cpu.stats();
+    }
+
+    Stats gpuStats(const std::string &name) const {
+        auto it = index.find(name);
+        return it == index.end() ? Stats() : passes[it->second].gpu.stats();
+    }
+
+    // Newest GPU time of a pass in ms, or a negative value if nothing arrived since the sample number in
+    // `seen`, which is advanced to the current one.
+    double newestGpu(const std::string &name, unsigned long &seen) const {
+        auto it = index.find(name);
+        if (it == index.end())
+            return -1.0;
+        const History &gpu = passes[it->second].gpu;
+        if (gpu.total() == seen)
+            return -1.0;
+        seen = gpu.total();
+        return gpu.newest();
+    }
+
+    bool writeCsv(const std::string &path) const {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "Failed to write profile: " << path << std::endl;
+            return false;
+        }
+        out << "pass,clock,samples,min_ms,avg_ms,p99_ms\n";
+        for (const auto &pass : passes) {
+            writeCsvRow(out, pass.name, "cpu", pass.cpu.stats());
+            writeCsvRow(out, pass.name, "gpu", pass.gpu.stats());
+        }
+        return true;
+    }
+
+    bool writeJson(const std::string &path) const {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "Failed to write profile: " << path << std::endl;
+            return false;
+        }
+        out << "{\n  \"passes\": [";
+        for (size_t i = 0; i < passes.size(); i++) {
+            out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << passes[i].name << "\", \"cpu\": ";
+            writeJsonStats(out, passes[i].cpu.stats());
+            out << ", \"gpu\": ";
+            writeJsonStats(out, passes[i].gpu.stats());
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+        return true;
+    }
+
+    // Writes <basePath>.csv and <basePath>.json.
+    void dump(const std::string &basePath) const {
+        if (writeCsv(basePath + ".csv") && writeJson(basePath + ".json"))
+            std::cout << "Profile written to " << basePath << ".csv/.json" << std::endl;
+    }
+
+    // Frees the query objects; call while the context is still current.
+    void clear() {
+        if (!allQueries.empty())
+            glDeleteQueries(allQueries.size(), allQueries.data());
+        allQueries.clear();
+        freeQueries.clear();
+        for (auto &pending : frames)
+            pending.clear();
+        open.clear();
+    }
+
+private:
+    class History {
+    public:
+        void add(double ms) {
+            if (samples.size() < HISTORY)
+                samples.push_back(ms);
+            else
+                samples[next] = ms;
+            next = (next + 1) % HISTORY;
+            added++;
+        }
+
+        double newest() const {
+            return samples.empty() ? 0.0 : samples[(next + samples.size() - 1) % samples.size()];
+        }
+
+        unsigned long total() const {
+            return added;
+        }
+
+        Stats stats() const {
+            Stats result;
+            if (samples.empty())
+                return result;
+            std::vector<double> sorted(samples);
+            std::sort(sorted.begin(), sorted.end());
+            result.samples = sorted.size();
+            result.min = sorted.front();
+            for (double sample : sorted)
+                result.avg += sample;
+            result.avg /= sorted.size();
+            result.p99 = sorted[std::min(sorted.size() - 1, (size_t) (sorted.size() * 0.99))];
+            return result;
+        }
+
+    private:
+        std::vector<double> samples;
+        size_t next = 0;
+        unsigned long added = 0;
+    };
+
+    struct Pass {
+        std::string name;
+        History cpu;
+        History gpu;
+    };
+
+    struct OpenScope {
+        int pass;
+        std::chrono::steady_clock::time_point cpuStart;
+        unsigned int query = 0;
+    };
+
+    struct PendingQuery {
+        int pass;
+        unsigned int start;
+        unsigned int end;
+    };
+
+    std::vector<Pass> passes;
+    std::unordered_map<std::string, int> index;
+    std::vector<OpenScope> open;
+    std::vector<PendingQuery> frames[FRAME_LATENCY];
+    int frame = 0;
+    std::vector<unsigned int> freeQueries;
+    std::vector<unsigned int> allQueries;
+
+    int passIndex(const std::string &name) {
+        auto it = index.find(name);
+        if (it != index.end())
+            return it->second;
+        passes.push_back({name, History(), History()});
+        index[name] = passes.size() - 1;
+        return passes.size() - 1;
+    }
+
+    unsigned int acquireQuery() {
+        if (freeQueries.empty()) {
+            unsigned int query;
+            glGenQueries(1, &query);
+            allQueries.push_back(query);
+            return query;
+        }
+        unsigned int query = freeQueries.back();
+        freeQueries.pop_back();
+        return query;
+    }
+
+    static void writeCsvRow(std::ofstream &out, const std::string &name, const char *clock, const Stats &stats) {
+        out << name << "," << clock << "," << stats.samples << "," << stats.min << "," << stats.avg << ","
+            << stats.p99 << "\n";
+    }
+
+    static void writeJsonStats(std::ofstream &out, const Stats &stats) {
+        out << "{\"samples\": " << stats.samples << ", \"min_ms\": " << stats.min << ", \"avg_ms\": " << stats.avg
+            << ", \"p99_ms\": " << stats.p99 << "}";
+    }
+};
+
+// Times the enclosing block as one pass.
+class ProfileScope {
+public:
+    ProfileScope(Profiler &profiler, const std::string &name) : profiler(profiler) {
+        profiler.begin(name);
+    }
+
+    ~ProfileScope() {
+        profiler.end();
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    Profiler &profiler;
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_PROFILER_H
@@ -0,0 +1,241 @@
+//
+// Sort-keyed render queue. Subsystems submit draw packets during the frame; the queue sorts them once
+// by a 64-bit key and the backend issues them while skipping program/texture/VAO/depth-state binds
+// that are already current.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_RENDER_QUEUE_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_RENDER_QUEUE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "geometry_arena.h"
+#include "shader.h"
+
+// Passes execute in this order. Only PASS_TRANSPARENT packets are expected to blend.
+enum RenderPass {
+    PASS_SHADOW = 0,         // static shadow casters, cached between frames
+    PASS_SHADOW_DYNAMIC = 1, // shadow casters that move, drawn over the cache every frame
+    PASS_REFLECTION = 2,     // mirrored scene above the water, into the reflection texture
+    PASS_REFRACTION = 3,     // scene below the water, into the refraction texture
+    PASS_DEPTH = 4,          // depth-only pre-pass for opaque geometry
+    PASS_OPAQUE = 5,
+    PASS_SKYBOX = 6,
+    PASS_TRANSPARENT = 7
+};
+
+const int MAX_PACKET_TEXTURES = 4;
+
+struct TextureBinding {
+    unsigned int unit;
+    GLenum target;
+    unsigned int id;
+};
+
+struct DrawPacket {
+    uint64_t key = 0;
+    RenderPass pass = PASS_OPAQUE;
+
+    const Shader *shader = nullptr;
+    unsigned int vao = 0;
+    TextureBinding textures[MAX_PACKET_TEXTURES]{};
+    int textureCount = 0;
+    GLenum depthFunc = GL_LESS;
+    bool depthWrite = true;
+    bool blend = false; // with the blend function set in initOpengl
+
+    GLenum mode = GL_TRIANGLES;
+    GLsizei count = 0;
+    bool indexed = false;
+    GLenum indexType = GL_UNSIGNED_INT;
+    GLsizei instances = 1;
+    // where the mesh starts in its VAO's buffers, for geometry that shares them (see GeometryArena)
+    GLint baseVertex = 0;
+    GLuint firstIndex = 0; // in indices of indexType
+
+    glm::mat4 model = glm::mat4(1.0f);
+    bool setModel = true;
+    glm::vec3 center = glm::vec3(0.0f); // world-space point used for depth sorting
+    // per-draw uniforms beyond "model"; runs with the packet's program bound
+    std::function<void(const Shader &)> uniforms;
+    // replaces the built-in draw call for packets that submit their own geometry (e.g. indirect draws)
+    std::function<void(const DrawPacket &)> draw;
+
+    DrawPacket &texture(unsigned int unit, GLenum target, unsigned int id) {
+        if (textureCount < MAX_PACKET_TEXTURES)
+            textures[textureCount++] = {unit, target, id};
+        return *this;
+    }
+
+    // Draws a range of an arena; the vao still has to be one of that arena's.
+    DrawPacket &geometry(const GeometryRange &range) {
+        baseVertex = range.baseVertex;
+        firstIndex = range.firstIndex;
+        indexed = range.indexCount > 0;
+        count = indexed ? range.indexCount : range.vertexCount;
+        indexType = GL_UNSIGNED_INT;
+        return *this;
+    }
+};
+
+// Key layout, most significant first:
+//   transparent:  pass(4) | depth(24, far to near) | program(10) | texture(12) | vao(12)
+//   other passes: pass(4) | program(10) | texture(12) | vao(12) | depth(24, near to far)
+// GL names are truncated to their field width, which only affects grouping, never correctness.
+uint64_t makeSortKey(RenderPass pass, unsigned int program, unsigned int texture, unsigned int vao, float depth) {
+    uint64_t d = (uint64_t) (glm::clamp(depth, 0.0f, 1.0f) * 0xFFFFFF);
+    uint64_t state = ((uint64_t) (program & 0x3FF) << 24) | ((uint64_t) (texture & 0xFFF) << 12) | (vao & 0xFFF);
+    uint64_t key = (uint64_t) pass << 60;
+    if (pass == PASS_TRANSPARENT)
+        return key | ((0xFFFFFF - d) << 36) | state;
+    return key | (state << 24) | d;
+}
+
+class RenderQueue {
+public:
+    // Camera used to derive the depth part of the sort key for subsequent submits.
+    void setCamera(const glm::vec3 &position, float farPlane) {
+        cameraPosition = position;
+        cameraFar = farPlane;
+    }
+
+    void submit(DrawPacket packet) {
+        float depth = glm::length(packet.center - cameraPosition) / cameraFar;
+        unsigned int texture = packet.textureCount > 0 ? packet.textures[0].id : 0;
+        packet.key = makeSortKey(packet.pass, packet.shader->ID, texture, packet.vao, depth);
+        packets.push_back(std::move(packet));
+    }
+
+    void clear() {
+        packets.clear();
+        stats = Stats();
+    }
+
+    size_t size() const {
+        return packets.size();
+    }
+
+    void sort() {
+        std::stable_sort(packets.begin(), packets.end(),
+                         [](const DrawPacket &a, const DrawPacket &b) { return a.key < b.key; });
+    }
+
+    // Executes the packets of the given passes in key order. Call sort() first.
+    void execute(RenderPass first = PASS_SHADOW, RenderPass last = PASS_TRANSPARENT) {
+        invalidate();
+        for (const auto &packet : packets) {
+            if (packet.pass < first || packet.pass > last)
+                continue;
+
+            if (packet.shader->ID != currentProgram) {
+                packet.shader->use();
+                currentProgram = packet.shader->ID;
+                stats.programBinds++;
+            }
+            for (int i = 0; i < packet.textureCount; i++) {
+                const TextureBinding &binding = packet.textures[i];
+                if (boundTextures[binding.unit] != binding.id) {
+                    glActiveTexture(GL_TEXTURE0 + binding.unit);
+                    glBindTexture(binding.target, binding.id);
+                    boundTextures[binding.unit] = binding.id;
+                    stats.textureBinds++;
+                }
+            }
+            if (packet.vao != currentVao) {
+                glBindVertexArray(packet.vao);
+                currentVao = packet.vao;
+                stats.vaoBinds++;
+            }
+            if (packet.depthFunc != currentDepthFunc) {
+                glDepthFunc(packet.depthFunc);
+                currentDepthFunc = packet.depthFunc;
+            }
+            if (packet.depthWrite != currentDepthWrite) {
+                glDepthMask(packet.depthWrite ? GL_TRUE : GL_FALSE);
+                currentDepthWrite = packet.depthWrite;
+            }
+            if (packet.blend != currentBlend) {
+                if (packet.blend)
+                    glEnable(GL_BLEND);
+                else
+                    glDisable(GL_BLEND);
+                currentBlend = packet.blend;
+            }
+
+            if (packet.setModel)
+                packet.shader->setMat4("model", packet.model);
+            if (packet.uniforms)
+                packet.uniforms(*packet.shader);
+
+            if (packet.draw) {
+                packet.draw(packet);
+            } else if (packet.indexed) {
+                auto offset = (void *) (packet.firstIndex * indexSize(packet.indexType));
+                if (packet.instances != 1)
+                    glDrawElementsInstancedBaseVertex(packet.mode, packet.count, packet.indexType, offset,
+                                                      packet.instances, packet.baseVertex);
+                else
+                    glDrawElementsBaseVertex(packet.mode, packet.count, packet.indexType, offset, packet.baseVertex);
+            } else if (packet.instances != 1) {
+                glDrawArraysInstanced(packet.mode, packet.baseVertex, packet.count, packet.instances);
+            } else {
+                glDrawArrays(packet.mode, packet.baseVertex, packet.count);
+            }
+            stats.draws++;
+        }
+
+        // leave the context the way the rest of the code expects it
+        glBindVertexArray(0);
+        if (currentDepthFunc != GL_LESS)
+            glDepthFunc(GL_LESS);
+        if (!currentDepthWrite)
+            glDepthMask(GL_TRUE);
+        if (currentBlend)
+            glDisable(GL_BLEND);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    struct Stats {
+        int draws = 0;
+        int programBinds = 0;
+        int textureBinds = 0;
+        int vaoBinds = 0;
+    } stats;
+
+private:
+    std::vector<DrawPacket> packets;
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float cameraFar = 100.0f;
+
+    unsigned int currentProgram = 0;
+    unsigned int currentVao = 0;
+    GLenum currentDepthFunc = GL_LESS;
+    bool currentDepthWrite = true;
+    bool currentBlend = false;
+    unsigned int boundTextures[32]{};
+
+    static size_t indexSize(GLenum type) {
+        return type == GL_UNSIGNED_BYTE ? 1 : type == GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+
+    // Anything outside the queue may have touched GL state, so every execute starts from scratch.
+    void invalidate() {
+        currentProgram = ~0u;
+        currentVao = ~0u;
+        currentDepthFunc = GL_LESS;
+        currentDepthWrite = true;
+        currentBlend = false;
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
+        std::fill(std::begin(boundTextures), std::end(boundTextures), ~0u);
+    }
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_RENDER_QUEUE_H
@@ -13,6 +13,8 @@
 #include <sstream>
 #include <iostream>
 
+#include "gl_resources.h"
+
 class Shader {
 public:
     unsigned int ID;
@@ -85,7 +87,7 @@ public:
             checkCompileErrors(geometry, "GEOMETRY");
         }
         // shader Program
-        ID = glCreateProgram();
+        ID = program.create();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
         if (geometryPath != nullptr)
@@ -176,6 +178,9 @@ public:
     }
 
 private:
+    // deletes the program with the shader
+    GLProgram program;
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type) {
@@ -0,0 +1,304 @@
+//
+// Cascaded shadow maps. The camera frustum is split along its depth, every split gets a light-space
+// orthographic projection fitted tightly around it (bounding sphere, snapped to whole shadow texels so
+// the edges don't shimmer as the camera moves), and all cascades live in the layers of one depth
+// texture array. The array uses a sized 16- or 24-bit depth format and is sampled with hardware
+// depth comparison.
+//
+// Static casters are rendered into a cached copy of the array. Each cascade's cached frustum is anchored
+// in world space and made cacheMargin larger than its slice, so a moving camera keeps using it until the
+// slice leaves it; only then is the cascade re-anchored and redrawn. A turning light redraws at most one
+// cascade per frame, the one furthest past its tolerance (cacheAngle, scaled by the cascade's texel size).
+// Changed static geometry redraws them all. Dynamic casters are composited on top of a copy of the cache.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_SHADOW_CASCADES_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_SHADOW_CASCADES_H
+
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "frustum.h"
+#include "gl_resources.h"
+#include "shader.h"
+
+const int MAX_SHADOW_CASCADES = 4;
+
+// filter used by ShadowCalculation; every tap is a hardware 2x2 PCF lookup
+enum ShadowKernel {
+    SHADOW_KERNEL_HARD = 0,   // 1 tap
+    SHADOW_KERNEL_GRID = 1,   // 4 taps, same footprint as a 3x3 point-sampled PCF
+    SHADOW_KERNEL_POISSON = 2 // 8 taps on a per-pixel rotated Poisson disk
+};
+
+class ShadowCascades {
+public:
+    int count;
+    int resolution;
+    GLenum depthFormat; // GL_DEPTH_COMPONENT16 or GL_DEPTH_COMPONENT24
+    ShadowKernel kernel = SHADOW_KERNEL_POISSON;
+    float kernelRadius = 1.5f; // Poisson disk radius in texels
+    // 0 = uniform splits, 1 = logarithmic splits
+    float splitLambda = 0.75f;
+    // how far behind each cascade casters are still captured, in world units
+    float casterDistance = 200.0f;
+    // how far the light may turn before the first cascade's cached static shadows are redrawn; coarser
+    // cascades tolerate proportionally more
+    float cacheAngle = glm::radians(0.5f);
+    // how much larger than its slice a cascade's cached frustum is, the room the camera has to move in
+    float cacheMargin = 0.25f;
+
+    GLTexture depthArray;   // static + dynamic casters, sampled by the receivers
+    GLTexture staticArray;  // static casters only
+    GLFramebuffer FBO;
+    GLFramebuffer staticFBO;
+    std::vector<float> splits;            // far view-space distance of each cascade
+    std::vector<glm::mat4> lightSpace;    // projection * view per cascade
+
+    ShadowCascades(int count, int resolution, GLenum depthFormat = GL_DEPTH_COMPONENT16)
+            : count(std::min(count, MAX_SHADOW_CASCADES)), resolution(resolution), depthFormat(depthFormat) {}
+
+    void init() {
+        createArray(depthArray);
+        createArray(staticArray);
+        // the sampled array compares in hardware (sampler2DArrayShadow) and filters the results bilinearly
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        createFramebuffer(FBO, depthArray);
+        createFramebuffer(staticFBO, staticArray);
+        staticDirty.assign(count, true);
+        dynamicDrawn.assign(count, false);
+        caches.assign(count, CascadeCache());
+    }
+
+    void destroy() {
+        FBO.reset();
+        staticFBO.reset();
+        depthArray.reset();
+        staticArray.reset();
+    }
+
+    // Forces every cascade to be re-anchored and its static casters redrawn on the next update.
+    void invalidate() {
+        for (auto &cache : caches)
+            cache.valid = false;
+    }
+
+    // Fits the cascades to the current camera, re-anchoring those whose slice left their cached frustum.
+    // lightDir points from the light into the scene; staticVersion should change whenever static caster
+    // geometry does.
+    void update(const glm::mat4 &view, float fovY, float aspect, float nearPlane, float farPlane,
+                const glm::vec3 &lightDir, unsigned int staticVersion) {
+        splits.resize(count);
+        lightSpace.resize(count);
+        if (staticVersion != cachedVersion) {
+            cachedVersion = staticVersion;
+            invalidate();
+        }
+
+        for (int i = 0; i < count; i++) {
+            float p = (float) (i + 1) / count;
+            float logSplit = nearPlane * std::pow(farPlane / nearPlane, p);
+            float uniformSplit = nearPlane + (farPlane - nearPlane) * p;
+            splits[i] = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+        }
+
+        // bounding sphere of every slice, measured in view space so the radius only depends on the slice
+        // and doesn't wobble as the camera moves or turns
+        glm::mat4 inverseView = glm::inverse(view);
+        float tanY = std::tan(fovY * 0.5f), tanX = tanY * aspect;
+        std::vector<glm::vec3> centers(count);
+        std::vector<float> radii(count);
+        float splitNear = nearPlane;
+        for (int i = 0; i < count; i++) {
+            float splitFar = splits[i];
+            glm::vec3 center(0.0f);
+            glm::vec3 corners[8];
+            for (int c = 0; c < 8; c++) {
+                float d = c < 4 ? splitNear : splitFar;
+                corners[c] = glm::vec3(((c & 1) ? 1 : -1) * tanX * d, ((c & 2) ? 1 : -1) * tanY * d, -d);
+                center += corners[c] / 8.0f;
+            }
+            float radius = 0.0f;
+            for (const auto &corner : corners)
+                radius = std::max(radius, glm::length(corner - center));
+            radii[i] = std::ceil(radius * 16.0f) / 16.0f;
+            centers[i] = glm::vec3(inverseView * glm::vec4(center, 1.0f));
+            splitNear = splitFar;
+        }
+
+        // the light turned: refresh the cascade furthest past its tolerance, one per frame
+        glm::vec3 dir = glm::normalize(lightDir);
+        int turned = -1;
+        float worst = 1.0f;
+        for (int i = 0; i < count; i++) {
+            if (!caches[i].valid)
+                continue;
+            float angle = std::acos(glm::clamp(glm::dot(dir, caches[i].dir), -1.0f, 1.0f));
+            float behind = angle / (cacheAngle * radii[i] / radii[0]);
+            if (behind > worst) {
+                worst = behind;
+                turned = i;
+            }
+        }
+
+        for (int i = 0; i < count; i++) {
+            CascadeCache &cache = caches[i];
+            bool anchor = !cache.valid || i == turned || radii[i] != cache.radius;
+            if (!anchor) {
+                // still inside the cached frustum, in its own light space and depth range?
+                glm::vec3 offset = glm::abs(glm::vec3(lightRotation(cache.dir) * glm::vec4(centers[i], 1.0f)) -
+                                            cache.center);
+                anchor = std::max(offset.x, std::max(offset.y, offset.z)) + radii[i] > cache.extent;
+            }
+            if (anchor)
+                anchorCascade(i, dir, centers[i], radii[i]);
+            lightSpace[i] = cache.lightSpace;
+        }
+    }
+
+    // Brings every cascade up to date. renderStatic / renderDynamic draw the respective casters for
+    // light-space matrix i; dynamicMin/Max bound all dynamic casters in world space. Cascades with a
+    // valid cache and no dynamic casters in view cost nothing.
+    void render(const std::function<void(int, const glm::mat4 &)> &renderStatic,
+                const std::function<void(int, const glm::mat4 &)> &renderDynamic,
+                const glm::vec3 &dynamicMin, const glm::vec3 &dynamicMax) {
+        glViewport(0, 0, resolution, resolution);
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(1.5f, 3.0f);
+        stats = Stats();
+
+        for (int i = 0; i < count; i++) {
+            bool dynamicVisible = Frustum(lightSpace[i]).isBoxVisible(dynamicMin, dynamicMax);
+            bool refreshed = staticDirty[i];
+            if (refreshed) {
+                bindLayer(staticFBO, staticArray, i);
+                glClear(GL_DEPTH_BUFFER_BIT);
+                renderStatic(i, lightSpace[i]);
+                staticDirty[i] = false;
+                stats.staticRedraws++;
+            }
+            // the sampled layer needs a fresh copy of the cache if the cache changed, if dynamic casters
+            // are drawn this frame, or to erase the ones drawn last frame
+            if (!refreshed && !dynamicVisible && !dynamicDrawn[i])
+                continue;
+
+            bindLayer(staticFBO, staticArray, i);
+            bindLayer(FBO, depthArray, i);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFBO);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+            glBlitFramebuffer(0, 0, resolution, resolution, 0, 0, resolution, resolution, GL_DEPTH_BUFFER_BIT,
+                              GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+            if (dynamicVisible) {
+                renderDynamic(i, lightSpace[i]);
+                stats.dynamicComposites++;
+            }
+            dynamicDrawn[i] = dynamicVisible;
+        }
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Uploads the cascade uniforms used by ShadowCalculation in the receiving shaders.
+    void apply(const Shader &shader) const {
+        shader.setInt("cascadeCount", count);
+        shader.setInt("shadowKernel", kernel);
+        shader.setFloat("shadowRadius", kernelRadius);
+        for (int i = 0; i < count; i++) {
+            shader.setFloat("cascadeSplits[" + std::to_string(i) + "]", splits[i]);
+            shader.setMat4("lightSpaceMatrices[" + std::to_string(i) + "]", lightSpace[i]);
+        }
+    }
+
+    struct Stats {
+        int staticRedraws = 0;
+        int dynamicComposites = 0;
+    } stats;
+
+private:
+    // a cascade's cached static frustum; receivers sample with the same matrix
+    struct CascadeCache {
+        bool valid = false;
+        glm::vec3 dir = glm::vec3(0.0f); // light direction it was drawn with
+        glm::vec3 center = glm::vec3(0.0f); // in that direction's light space, snapped to texels
+        float radius = 0.0f;                // of the slice it was fitted to
+        float extent = 0.0f;                // half-size of the frustum, radius plus the margin
+        glm::mat4 lightSpace = glm::mat4(1.0f);
+    };
+
+    unsigned int cachedVersion = ~0u;
+    std::vector<CascadeCache> caches;
+    std::vector<bool> staticDirty;
+    std::vector<bool> dynamicDrawn;
+
+    static glm::vec3 upFor(const glm::vec3 &dir) {
+        return std::abs(dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    static glm::mat4 lightRotation(const glm::vec3 &dir) {
+        return glm::lookAt(glm::vec3(0.0f), dir, upFor(dir));
+    }
+
+    // Centers cascade i's cached frustum on the slice and marks its static casters for redrawing.
+    void anchorCascade(int i, const glm::vec3 &dir, const glm::vec3 &center, float radius) {
+        CascadeCache &cache = caches[i];
+        cache.valid = true;
+        cache.dir = dir;
+        cache.radius = radius;
+        cache.extent = radius * (1.0f + cacheMargin);
+
+        // snap the center to the shadow texel grid in light space, so re-anchoring never shifts texels
+        // against the world and the edges don't shimmer
+        float texel = 2.0f * cache.extent / resolution;
+        glm::mat4 rotation = lightRotation(dir);
+        cache.center = glm::floor(glm::vec3(rotation * glm::vec4(center, 1.0f)) / texel) * texel;
+        glm::vec3 snapped = glm::vec3(glm::inverse(rotation) * glm::vec4(cache.center, 1.0f));
+
+        glm::mat4 lightView = glm::lookAt(snapped - dir * (cache.extent + casterDistance), snapped, upFor(dir));
+        glm::mat4 lightProjection = glm::ortho(-cache.extent, cache.extent, -cache.extent, cache.extent, 0.0f,
+                                               2.0f * cache.extent + casterDistance);
+        cache.lightSpace = lightProjection * lightView;
+        staticDirty[i] = true;
+    }
+
+    void createArray(GLTexture &texture) const {
+        texture.create();
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, depthFormat, resolution, resolution, count, 0, GL_DEPTH_COMPONENT,
+                     depthFormat == GL_DEPTH_COMPONENT16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, nullptr);
+        // 24-bit depth is stored in 32 bits
+        texture.setBytes((long long) resolution * resolution * count * (depthFormat == GL_DEPTH_COMPONENT16 ? 2 : 4));
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        float border[] = {1.0f, 1.0f, 1.0f, 1.0f};
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+    }
+
+    static void createFramebuffer(GLFramebuffer &framebuffer, unsigned int array) {
+        framebuffer.create();
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, array, 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    static void bindLayer(unsigned int framebuffer, unsigned int array, int layer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, array, 0, layer);
+    }
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_SHADOW_CASCADES_H
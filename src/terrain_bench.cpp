@@ -0,0 +1,213 @@
+//
+// CPU microbenchmark for the terrain and water generation kernels. Needs no GL context, so it runs
+// anywhere the sources compile. Every kernel is timed on its own with prepared inputs, over a set of
+// grid sizes and thread counts; with N threads, N instances of the kernel run concurrently and the
+// wall time until all of them finish is recorded. The noise kernels draw their seeded values from the
+// global rand() under worldSeedMutex; that's a few hundred calls per run, next to one Perlin evaluation
+// per cell, so concurrent runs serialize only briefly and produce the single-threaded output.
+//
+// Sizes of 2^n + 1 hit the resolution-specialized kernels in map_generator.h.
+//
+// usage: terrain_bench [--sizes 200,512,...] [--threads 1,2,...] [--reps N] [--warmup N] [--output file.json]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "map_generator.h"
+#include "water.h"
+
+struct Kernel {
+    std::string name;
+    std::function<void(int size)> prepare;
+    std::function<size_t(int size)> run; // returns something derived from the output so it isn't optimised away
+};
+
+struct Result {
+    std::string kernel;
+    int size;
+    int threads;
+    double minMs;
+    double medianMs;
+    double avgMs;
+    double cellsPerSecond;
+};
+
+std::vector<int> parseList(const char *text) {
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (!item.empty())
+            values.push_back(std::max(1, atoi(item.c_str())));
+    return values;
+}
+
+// inputs for the kernels that consume another kernel's output, built outside the timed region
+std::vector<int> benchIndices;
+std::vector<float> benchNoiseMap;
+std::vector<float> benchVertices;
+
+TerrainConfig benchConfig(int size) {
+    TerrainConfig config;
+    config.resolution = size;
+    return config;
+}
+
+std::vector<Kernel> createKernels() {
+    std::vector<Kernel> kernels;
+    Water water;
+    auto noPrepare = [](int) {};
+
+    kernels.push_back({"perlin_noise", noPrepare, [](int size) {
+        std::vector<int> p = get_permutation_vector();
+        double sum = 0.0;
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++)
+                sum += perlin_noise(x / noiseScale, y / noiseScale, p);
+        return (size_t) (sum != 0.0);
+    }});
+    kernels.push_back({"generateNoiseMap", noPrepare, [](int size) {
+        return generateNoiseMap(benchConfig(size)).size();
+    }});
+    kernels.push_back({"generateIndices", noPrepare, [](int size) {
+        return generateIndices(benchConfig(size)).size();
+    }});
+    kernels.push_back({"generateVertices", [](int size) {
+        benchNoiseMap = generateNoiseMap(benchConfig(size));
+    }, [](int size) {
+        return generateVertices(benchNoiseMap, benchConfig(size)).size();
+    }});
+    kernels.push_back({"generateNormals", [](int size) {
+        benchIndices = generateIndices(benchConfig(size));
+        benchVertices = generateVertices(generateNoiseMap(benchConfig(size)), benchConfig(size));
+    }, [](int) {
+        return generateNormals(benchIndices, benchVertices).size();
+    }});
+    kernels.push_back({"generateColors", [](int size) {
+        benchVertices = generateVertices(generateNoiseMap(benchConfig(size)), benchConfig(size));
+    }, [](int) {
+        return generateColors(benchVertices).size();
+    }});
+    kernels.push_back({"Water::initVertices", noPrepare, [water](int size) mutable {
+        auto vertices = water.initVertices(size, 0.5f, -25.0f);
+        size_t count = vertices->size();
+        delete vertices;
+        return count;
+    }});
+    kernels.push_back({"Water::initIndices", noPrepare, [water](int size) mutable {
+        auto indices = water.initIndices(size);
+        size_t count = indices->size();
+        delete indices;
+        return count;
+    }});
+    return kernels;
+}
+
+// Wall time of `threads` concurrent runs, in milliseconds.
+double timeConcurrent(const Kernel &kernel, int size, int threads) {
+    std::vector<size_t> sinks(threads);
+    auto start = std::chrono::steady_clock::now();
+    if (threads == 1) {
+        sinks[0] = kernel.run(size);
+    } else {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+            workers.emplace_back([&, t] { sinks[t] = kernel.run(size); });
+        for (auto &worker : workers)
+            worker.join();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    volatile size_t sink = 0;
+    for (size_t value : sinks)
+        sink = sink + value;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+Result measure(const Kernel &kernel, int size, int threads, int warmup, int reps) {
+    for (int i = 0; i < warmup; i++)
+        timeConcurrent(kernel, size, threads);
+
+    std::vector<double> times;
+    for (int i = 0; i < reps; i++)
+        times.push_back(timeConcurrent(kernel, size, threads));
+    std::sort(times.begin(), times.end());
+
+    Result result{kernel.name, size, threads, times.front(), times[times.size() / 2], 0.0, 0.0};
+    for (double time : times)
+        result.avgMs += time / times.size();
+    result.cellsPerSecond = (double) size * size * threads / (result.medianMs / 1000.0);
+    return result;
+}
+
+bool writeJson(const std::string &path, const std::vector<Result> &results, int warmup, int reps) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "Failed to write " << path << std::endl;
+        return false;
+    }
+    out << "{\n  \"warmup\": " << warmup << ",\n  \"reps\": " << reps << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"kernel\": \"" << r.kernel << "\", \"size\": " << r.size
+            << ", \"threads\": " << r.threads << ", \"min_ms\": " << r.minMs << ", \"median_ms\": " << r.medianMs
+            << ", \"avg_ms\": " << r.avgMs << ", \"cells_per_s\": " << r.cellsPerSecond << "}";
+    }
+    out << "\n  ]\n}\n";
+    return true;
+}
+
+int main(int argc, char **argv) {
+    std::vector<int> sizes{200, 257, 513, 1025, 2049, 4097};
+    std::vector<int> threadCounts{1, (int) std::max(1u, std::thread::hardware_concurrency())};
+    int reps = 5, warmup = 1;
+    std::string output = "terrain_bench.json";
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--sizes") == 0 && hasValue) {
+            sizes = parseList(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threadCounts = parseList(argv[++i]);
+        } else if (strcmp(argv[i], "--reps") == 0 && hasValue) {
+            reps = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--warmup") == 0 && hasValue) {
+            warmup = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            output = argv[++i];
+        } else {
+            std::cout << "usage: terrain_bench [--sizes 200,512,...] [--threads 1,2,...] [--reps N] [--warmup N]"
+                         " [--output file.json]" << std::endl;
+            return 1;
+        }
+    }
+    threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+
+    // fixed seed so runs are comparable
+    worldSeed = 1;
+    std::vector<Result> results;
+    for (const auto &kernel : createKernels()) {
+        for (int size : sizes) {
+            kernel.prepare(size);
+            for (int threads : threadCounts) {
+                Result result = measure(kernel, size, threads, warmup, reps);
+                std::cout << kernel.name << " size " << size << " threads " << threads << ": median "
+                          << result.medianMs << " ms, " << result.cellsPerSecond / 1e6 << " Mcells/s" << std::endl;
+                results.push_back(result);
+            }
+        }
+    }
+
+    return writeJson(output, results, warmup, reps) ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+//
+// Terrain split into square chunks of the index buffer. Each frame the chunks are culled against the
+// view frustum and the visible ones are drawn with a single glMultiDrawElementsIndirect call when the
+// context has GL 4.3 / ARB_multi_draw_indirect, or with one draw per chunk otherwise. The indices live
+// in a geometry arena, so every draw is offset by where the arena placed the mesh.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_TERRAIN_CHUNKS_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_TERRAIN_CHUNKS_H
+
+#include <algorithm>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "frustum.h"
+#include "geometry_arena.h"
+#include "gl_resources.h"
+#include "utils.h"
+
+// glad is generated for GL 4.1, so the 4.3 entry point is loaded by hand.
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC_)(GLenum mode, GLenum type, const void *indirect,
+                                                             GLsizei drawcount, GLsizei stride);
+
+const int TERRAIN_CHUNK_SIZE = 25; // quads per chunk side
+
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLuint baseVertex;
+    GLuint baseInstance;
+};
+
+struct TerrainChunk {
+    GLuint firstIndex;
+    GLuint count;
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+class TerrainChunks {
+public:
+    std::vector<TerrainChunk> chunks;
+    bool useMultiDrawIndirect = false;
+    unsigned int version = 0; // bumped on every rebuild
+    // where the indices returned by build() were placed in the arena, and the vertices they refer to
+    GeometryRange range;
+
+    // Call once the context is current. Falls back to per-chunk draws when MDI isn't available.
+    void init(GLADloadproc load) {
+        int major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        bool supported = major > 4 || (major == 4 && minor >= 3) || hasExtension("GL_ARB_multi_draw_indirect");
+        if (supported)
+            multiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC_) load("glMultiDrawElementsIndirect");
+        useMultiDrawIndirect = multiDrawElementsIndirect != nullptr;
+    }
+
+    // Reorders grid indices (six per quad, quads row by row as generateIndices emits them) so every
+    // chunk is one contiguous range, and records each chunk's range and bounds.
+    std::vector<int> build(const std::vector<int> &indices, const std::vector<float> &vertices, int gridSize) {
+        int quadsPerRow = gridSize - 1;
+        int chunksPerRow = (quadsPerRow + TERRAIN_CHUNK_SIZE - 1) / TERRAIN_CHUNK_SIZE;
+        std::vector<int> ordered;
+        ordered.reserve(indices.size());
+        chunks.clear();
+        version++;
+
+        for (int cy = 0; cy < chunksPerRow; cy++)
+            for (int cx = 0; cx < chunksPerRow; cx++) {
+                TerrainChunk chunk{(GLuint) ordered.size(), 0, glm::vec3(1e30f), glm::vec3(-1e30f)};
+                for (int y = cy * TERRAIN_CHUNK_SIZE; y < std::min((cy + 1) * TERRAIN_CHUNK_SIZE, quadsPerRow); y++)
+                    for (int x = cx * TERRAIN_CHUNK_SIZE; x < std::min((cx + 1) * TERRAIN_CHUNK_SIZE, quadsPerRow); x++) {
+                        size_t quad = ((size_t) y * quadsPerRow + x) * 6;
+                        for (int i = 0; i < 6; i++) {
+                            int index = indices[quad + i];
+                            glm::vec3 p(vertices[index * 3], vertices[index * 3 + 1], vertices[index * 3 + 2]);
+                            chunk.min = glm::min(chunk.min, p);
+                            chunk.max = glm::max(chunk.max, p);
+                            ordered.push_back(index);
+                        }
+                    }
+                chunk.count = (GLuint) ordered.size() - chunk.firstIndex;
+                if (chunk.count > 0)
+                    chunks.push_back(chunk);
+            }
+        return ordered;
+    }
+
+    // Selects the chunks whose bounds, moved by the model matrix and any instance offset, touch the frustum.
+    void cull(const glm::mat4 &viewProjection, const glm::mat4 &model, const std::vector<glm::vec3> &offsets) {
+        Frustum frustum(viewProjection);
+        glm::vec3 translation(model[3]);
+        glm::vec3 offsetMin, offsetMax;
+        offsetBounds(offsets, offsetMin, offsetMax);
+
+        visible.clear();
+        for (const auto &chunk : chunks)
+            if (frustum.isBoxVisible(chunk.min + offsetMin + translation, chunk.max + offsetMax + translation))
+                visible.push_back(&chunk);
+    }
+
+    // Drops visible chunks lying entirely on the negative side of a world-space plane (xyz normal, w
+    // offset), i.e. chunks a clip plane would remove completely.
+    void cullPlane(const glm::vec4 &plane, const glm::mat4 &model, const std::vector<glm::vec3> &offsets) {
+        glm::vec3 translation(model[3]);
+        glm::vec3 offsetMin, offsetMax;
+        offsetBounds(offsets, offsetMin, offsetMax);
+        glm::vec3 normal(plane);
+        visible.erase(std::remove_if(visible.begin(), visible.end(), [&](const TerrainChunk *chunk) {
+            glm::vec3 min = chunk->min + offsetMin + translation, max = chunk->max + offsetMax + translation;
+            // the box corner furthest along the normal
+            glm::vec3 corner(normal.x > 0.0f ? max.x : min.x, normal.y > 0.0f ? max.y : min.y,
+                             normal.z > 0.0f ? max.z : min.z);
+            return glm::dot(normal, corner) + plane.w < 0.0f;
+        }), visible.end());
+    }
+
+    // Orders the visible chunks nearest first, by the distance from eye to each chunk's box, so early
+    // depth testing rejects as much of the far terrain as possible.
+    void sortNearToFar(const glm::vec3 &eye, const glm::mat4 &model) {
+        glm::vec3 local = eye - glm::vec3(model[3]);
+        auto distance = [&](const TerrainChunk *chunk) {
+            glm::vec3 closest = glm::clamp(local, chunk->min, chunk->max);
+            glm::vec3 d = closest - local;
+            return glm::dot(d, d);
+        };
+        std::sort(visible.begin(), visible.end(), [&](const TerrainChunk *a, const TerrainChunk *b) {
+            return distance(a) < distance(b);
+        });
+    }
+
+    // Draws the visible chunks with a VAO of the terrain's arena bound.
+    void draw(GLenum mode, GLsizei instances) {
+        if (visible.empty())
+            return;
+
+        if (useMultiDrawIndirect) {
+            commands.clear();
+            for (const auto *chunk : visible)
+                commands.push_back({chunk->count, (GLuint) instances, range.firstIndex + chunk->firstIndex,
+                                    (GLuint) range.baseVertex, 0});
+
+            if (indirectBuffer == 0)
+                indirectBuffer.create();
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand),
+                         commands.data(), GL_STREAM_DRAW);
+            indirectBuffer.setBytes(commands.size() * sizeof(DrawElementsIndirectCommand));
+            multiDrawElementsIndirect(mode, GL_UNSIGNED_INT, nullptr, commands.size(), 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        } else {
+            for (const auto *chunk : visible)
+                glDrawElementsInstancedBaseVertex(mode, chunk->count, GL_UNSIGNED_INT,
+                                                  (void *) ((range.firstIndex + chunk->firstIndex) * sizeof(GLuint)),
+                                                  instances, range.baseVertex);
+        }
+    }
+
+    size_t visibleCount() const {
+        return visible.size();
+    }
+
+    void destroy() {
+        indirectBuffer.reset();
+    }
+
+private:
+    PFNGLMULTIDRAWELEMENTSINDIRECTPROC_ multiDrawElementsIndirect = nullptr;
+    GLBuffer indirectBuffer;
+    std::vector<const TerrainChunk *> visible;
+    std::vector<DrawElementsIndirectCommand> commands;
+
+    static void offsetBounds(const std::vector<glm::vec3> &offsets, glm::vec3 &min, glm::vec3 &max) {
+        min = max = glm::vec3(0.0f);
+        if (!offsets.empty()) {
+            min = max = offsets[0];
+            for (const auto &offset : offsets) {
+                min = glm::min(min, offset);
+                max = glm::max(max, offset);
+            }
+        }
+    }
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_TERRAIN_CHUNKS_H
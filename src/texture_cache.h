@@ -0,0 +1,120 @@
+//
+// Reference-counted texture cache. Textures are deduplicated by canonical path and by content hash,
+// so two paths to the same file (or two copies of the same image) share one GL texture, which is
+// deleted when the last reference is released.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_TEXTURE_CACHE_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_TEXTURE_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gl_resources.h"
+#include "utils.h"
+
+class TextureCache {
+public:
+    unsigned int acquire(const std::string &path) {
+        std::string key = canonicalPath(path);
+
+        auto found = byPath.find(key);
+        if (found != byPath.end()) {
+            entries[found->second].refs++;
+            return found->second;
+        }
+
+        uint64_t hash = hashFile(key);
+        auto sameContent = byHash.find(hash);
+        if (sameContent != byHash.end()) {
+            Entry &entry = entries[sameContent->second];
+            entry.refs++;
+            entry.keys.push_back(key);
+            byPath[key] = sameContent->second;
+            return sameContent->second;
+        }
+
+        unsigned int id = loadTexture(key.c_str());
+        add(id, GL_TEXTURE_2D, hash, key);
+        byPath[key] = id;
+        byHash[hash] = id;
+        return id;
+    }
+
+    void release(unsigned int id) {
+        auto found = entries.find(id);
+        if (found == entries.end() || --found->second.refs > 0)
+            return;
+
+        for (const auto &key : found->second.keys)
+            byPath.erase(key);
+        auto hashed = byHash.find(found->second.hash);
+        if (hashed != byHash.end() && hashed->second == id)
+            byHash.erase(hashed);
+        entries.erase(found);
+    }
+
+    // Deletes every cached texture regardless of outstanding references (shutdown only).
+    void clear() {
+        entries.clear();
+        byPath.clear();
+        byHash.clear();
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+private:
+    struct Entry {
+        int refs;
+        uint64_t hash;
+        std::vector<std::string> keys;
+        GLTexture texture; // deleted with the entry
+    };
+
+    std::unordered_map<unsigned int, Entry> entries;
+    std::unordered_map<std::string, unsigned int> byPath;
+    std::unordered_map<uint64_t, unsigned int> byHash;
+
+    void add(unsigned int id, GLenum target, uint64_t hash, const std::string &key) {
+        Entry &entry = entries[id];
+        entry.refs = 1;
+        entry.hash = hash;
+        entry.keys = {key};
+        entry.texture.adopt(id);
+        entry.texture.setBytes(textureBytes(target, id));
+        glBindTexture(target, 0);
+    }
+
+    static std::string canonicalPath(const std::string &path) {
+        std::error_code error;
+        auto canonical = std::filesystem::weakly_canonical(path, error);
+        return error ? path : canonical.string();
+    }
+
+    // FNV-1a over the file bytes
+    static uint64_t hashFile(const std::string &path) {
+        uint64_t hash = 14695981039346656037ull;
+        std::ifstream file(path, std::ios::binary);
+        char buffer[64 * 1024];
+        while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+            for (std::streamsize i = 0; i < file.gcount(); i++) {
+                hash ^= (unsigned char) buffer[i];
+                hash *= 1099511628211ull;
+            }
+        }
+        // unreadable files must not collide with each other through the empty-content hash
+        if (!file.eof())
+            hash ^= std::hash<std::string>{}(path);
+        return hash;
+    }
+};
+
+TextureCache textureCache;
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_TEXTURE_CACHE_H
@@ -0,0 +1,247 @@
+//
+// Offline texture converter: turns the source images in resources/ into block-compressed
+// DDS files (BC1 for opaque images, BC3 when any pixel has alpha) with a full mip chain.
+// loadTexture/loadCubemap pick the .dds twin up automatically and fall back to the source image.
+//
+// usage: texture_compressor [--force] <dir or image>...
+//
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "stb_image.h"
+#include "dds.h"
+
+namespace fs = std::filesystem;
+
+struct Rgba {
+    int width;
+    int height;
+    std::vector<unsigned char> pixels;
+};
+
+Rgba downsample(const Rgba &src) {
+    Rgba dst;
+    dst.width = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.pixels.resize((size_t) dst.width * dst.height * 4);
+
+    for (int y = 0; y < dst.height; y++)
+        for (int x = 0; x < dst.width; x++) {
+            int x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+            int y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+            for (int c = 0; c < 4; c++) {
+                int sum = src.pixels[(y0 * src.width + x0) * 4 + c] + src.pixels[(y0 * src.width + x1) * 4 + c] +
+                          src.pixels[(y1 * src.width + x0) * 4 + c] + src.pixels[(y1 * src.width + x1) * 4 + c];
+                dst.pixels[(y * dst.width + x) * 4 + c] = (unsigned char) ((sum + 2) / 4);
+            }
+        }
+    return dst;
+}
+
+uint16_t toRgb565(const int *c) {
+    return (uint16_t) (((c[0] * 31 + 127) / 255) << 11 | ((c[1] * 63 + 127) / 255) << 5 | ((c[2] * 31 + 127) / 255));
+}
+
+void fromRgb565(uint16_t v, int *c) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+// Bounding-box endpoint fit with a small inset, then nearest-palette index selection.
+void encodeColorBlock(const unsigned char block[16][4], unsigned char *out) {
+    int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++) {
+            lo[c] = std::min(lo[c], (int) block[i][c]);
+            hi[c] = std::max(hi[c], (int) block[i][c]);
+        }
+    for (int c = 0; c < 3; c++) {
+        int inset = (hi[c] - lo[c]) / 16;
+        lo[c] += inset;
+        hi[c] -= inset;
+    }
+
+    uint16_t c0 = toRgb565(hi), c1 = toRgb565(lo);
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        int palette[4][3];
+        fromRgb565(c0, palette[0]);
+        fromRgb565(c1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestDist = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+                int dist = dr * dr + dg * dg + db * db;
+                if (dist < bestDist) {
+                    bestDist = dist;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t) best << (2 * i);
+        }
+    }
+
+    memcpy(out, &c0, 2);
+    memcpy(out + 2, &c1, 2);
+    memcpy(out + 4, &indices, 4);
+}
+
+void encodeAlphaBlock(const unsigned char block[16][4], unsigned char *out) {
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++) {
+        a0 = std::max(a0, (int) block[i][3]);
+        a1 = std::min(a1, (int) block[i][3]);
+    }
+
+    uint64_t bits = 0;
+    if (a0 != a1) {
+        int palette[8] = {a0, a1};
+        for (int i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestDist = 256;
+            for (int p = 0; p < 8; p++) {
+                int dist = std::abs(block[i][3] - palette[p]);
+                if (dist < bestDist) {
+                    bestDist = dist;
+                    best = p;
+                }
+            }
+            bits |= (uint64_t) best << (3 * i);
+        }
+    }
+
+    out[0] = (unsigned char) a0;
+    out[1] = (unsigned char) a1;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (unsigned char) (bits >> (8 * i));
+}
+
+void compressLevel(const Rgba &level, DdsFormat format, unsigned char *out) {
+    unsigned char block[16][4];
+    size_t blockSize = ddsBlockSize(format);
+
+    for (int by = 0; by < level.height; by += 4)
+        for (int bx = 0; bx < level.width; bx += 4) {
+            for (int i = 0; i < 16; i++) {
+                int x = std::min(bx + i % 4, level.width - 1);
+                int y = std::min(by + i / 4, level.height - 1);
+                memcpy(block[i], &level.pixels[((size_t) y * level.width + x) * 4], 4);
+            }
+            if (format == DDS_BC3) {
+                encodeAlphaBlock(block, out);
+                encodeColorBlock(block, out + 8);
+            } else {
+                encodeColorBlock(block, out);
+            }
+            out += blockSize;
+        }
+}
+
+bool isSourceImage(const fs::path &path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tga";
+}
+
+bool convert(const fs::path &source, bool force, size_t &rawBytes, size_t &compressedBytes) {
+    fs::path target = ddsPathFor(source.string());
+    if (!force && fs::exists(target) && fs::last_write_time(target) >= fs::last_write_time(source)) {
+        std::cout << "up to date: " << target.string() << std::endl;
+        return true;
+    }
+
+    Rgba level;
+    int channels;
+    unsigned char *data = stbi_load(source.string().c_str(), &level.width, &level.height, &channels, 4);
+    if (!data) {
+        std::cout << "Texture failed to load at path: " << source.string() << std::endl;
+        return false;
+    }
+    level.pixels.assign(data, data + (size_t) level.width * level.height * 4);
+    stbi_image_free(data);
+
+    bool hasAlpha = false;
+    for (size_t i = 3; i < level.pixels.size() && !hasAlpha; i += 4)
+        hasAlpha = level.pixels[i] != 255;
+
+    DdsImage image;
+    image.format = hasAlpha ? DDS_BC3 : DDS_BC1;
+    image.width = level.width;
+    image.height = level.height;
+
+    while (true) {
+        size_t size = ddsLevelSize(image.format, level.width, level.height);
+        image.levels.push_back({level.width, level.height, image.data.size(), size});
+        image.data.resize(image.data.size() + size);
+        compressLevel(level, image.format, &image.data[image.levels.back().offset]);
+        rawBytes += (size_t) level.width * level.height * (hasAlpha ? 4 : 3);
+
+        if (level.width == 1 && level.height == 1)
+            break;
+        level = downsample(level);
+    }
+    compressedBytes += image.data.size();
+
+    if (!writeDds(target.string(), image)) {
+        std::cout << "Failed to write " << target.string() << std::endl;
+        return false;
+    }
+    std::cout << (hasAlpha ? "BC3 " : "BC1 ") << image.width << "x" << image.height << " "
+              << image.levels.size() << " mips -> " << target.string() << std::endl;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    bool force = false;
+    std::vector<fs::path> sources;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--force") == 0) {
+            force = true;
+            continue;
+        }
+        fs::path path(argv[i]);
+        if (fs::is_directory(path)) {
+            for (const auto &entry : fs::directory_iterator(path))
+                if (entry.is_regular_file() && isSourceImage(entry.path()))
+                    sources.push_back(entry.path());
+        } else if (fs::exists(path)) {
+            sources.push_back(path);
+        } else {
+            std::cout << "No such file or directory: " << path.string() << std::endl;
+        }
+    }
+
+    if (sources.empty()) {
+        std::cout << "usage: texture_compressor [--force] <dir or image>..." << std::endl;
+        return 1;
+    }
+
+    std::sort(sources.begin(), sources.end());
+    size_t rawBytes = 0, compressedBytes = 0;
+    int failed = 0;
+    for (const auto &source : sources)
+        if (!convert(source, force, rawBytes, compressedBytes))
+            failed++;
+
+    if (compressedBytes > 0)
+        std::cout << "uncompressed " << rawBytes / 1024 << " KiB -> compressed " << compressedBytes / 1024
+                  << " KiB (" << (float) rawBytes / compressedBytes << "x)" << std::endl;
+
+    return failed == 0 ? 0 : 1;
+}
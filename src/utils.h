@@ -1,10 +1,69 @@
 #ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_UTILS_H
 #define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_UTILS_H
 
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "stb_image.h"
+#include "dds.h"
+
+// S3TC is an extension on desktop GL, so glad (4.1 core, no extensions) doesn't define these.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+bool hasExtension(const char *name) {
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (int i = 0; i < count; i++) {
+        auto extension = (const char *) glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool supportsS3tc() {
+    static int supported = -1;
+    if (supported == -1)
+        supported = hasExtension("GL_EXT_texture_compression_s3tc") ? 1 : 0;
+    return supported == 1;
+}
+
+// Uploads every mip level of a pre-compressed image into the currently bound texture.
+void uploadDds(GLenum target, const DdsImage &image) {
+    GLenum format = image.format == DDS_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    for (unsigned int level = 0; level < image.levels.size(); level++) {
+        const DdsLevel &l = image.levels[level];
+        glCompressedTexImage2D(target, level, format, l.width, l.height, 0, l.size, &image.data[l.offset]);
+    }
+}
+
 unsigned int loadTexture(char const *path) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
+    // prefer the offline-compressed twin produced by texture_compressor
+    DdsImage compressed;
+    if (supportsS3tc() && loadDds(ddsPathFor(path), compressed)) {
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        uploadDds(GL_TEXTURE_2D, compressed);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, compressed.levels.size() - 1);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return textureID;
+    }
+
     int width, height, nrComponents;
     unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
     if (data) {
@@ -39,19 +98,37 @@ unsigned int loadCubemap(std::vector<std::string> faces) {
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE,
-                         data);
-            stbi_image_free(data);
-        } else {
-            std::cout << "Cubemap tex failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
+    // the compressed path is all-or-nothing so every face ends up square, with the same format, size and mip count
+    std::vector<DdsImage> compressed(faces.size());
+    bool useCompressed = supportsS3tc();
+    for (unsigned int i = 0; i < faces.size() && useCompressed; i++)
+        useCompressed = loadDds(ddsPathFor(faces[i]), compressed[i]) &&
+                        compressed[i].format == compressed[0].format &&
+                        compressed[i].width == compressed[0].width &&
+                        compressed[i].height == compressed[i].width &&
+                        compressed[i].levels.size() == compressed[0].levels.size();
+
+    int mipLevels = 1;
+    if (useCompressed) {
+        for (unsigned int i = 0; i < faces.size(); i++)
+            uploadDds(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, compressed[i]);
+        mipLevels = compressed[0].levels.size();
+    } else {
+        int width, height, nrChannels;
+        for (unsigned int i = 0; i < faces.size(); i++) {
+            unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
+            if (data) {
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE,
+                             data);
+                stbi_image_free(data);
+            } else {
+                std::cout << "Cubemap tex failed to load at path: " << faces[i] << std::endl;
+                stbi_image_free(data);
+            }
         }
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, mipLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -0,0 +1,143 @@
+//
+// Reports the vertex cache miss ratio (ACMR) of the scene's meshes before and after the load-time
+// reordering in vertex_cache.h, under FIFO caches of a few sizes, together with how long the
+// reordering takes. Needs no GL context. A triangle-shuffled grid stands in for meshes exported in
+// no particular order.
+//
+// usage: vertex_cache_bench [--sizes 65,200,...] [--output file.json]
+//
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "map_generator.h"
+#include "vertex_cache.h"
+#include "water.h"
+
+const int CACHE_SIZES[] = {16, 32};
+
+struct Result {
+    std::string mesh;
+    int size;
+    size_t triangles;
+    double before[2];
+    double after[2];
+    double optimizeMs;
+};
+
+std::vector<int> parseList(const char *text) {
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (!item.empty())
+            values.push_back(std::max(2, atoi(item.c_str())));
+    return values;
+}
+
+// Measures ACMR, optimizes (per range, so terrain chunks stay contiguous) and measures again.
+Result measure(const std::string &name, int size, std::vector<unsigned int> indices,
+               const std::vector<std::pair<size_t, size_t>> &ranges) {
+    Result result{name, size, indices.size() / 3, {}, {}, 0.0};
+    for (int i = 0; i < 2; i++)
+        result.before[i] = vertexCacheMissRatio(indices, CACHE_SIZES[i]);
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &range : ranges)
+        optimizeVertexCache(indices.data() + range.first, range.second);
+    result.optimizeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (int i = 0; i < 2; i++)
+        result.after[i] = vertexCacheMissRatio(indices, CACHE_SIZES[i]);
+    return result;
+}
+
+std::vector<Result> measureSize(int size) {
+    std::vector<Result> results;
+    TerrainConfig config;
+    config.resolution = size;
+    std::vector<int> grid = generateIndices(config);
+    std::vector<unsigned int> gridIndices(grid.begin(), grid.end());
+    results.push_back(measure("terrain_grid", size, gridIndices, {{0, gridIndices.size()}}));
+
+    // what the renderer draws: the grid regrouped into chunks, each reordered on its own
+    std::vector<float> vertices = generateVertices(generateNoiseMap(config), config);
+    TerrainChunks chunks;
+    std::vector<int> chunked = chunks.build(grid, vertices, size);
+    std::vector<std::pair<size_t, size_t>> chunkRanges;
+    for (const auto &chunk : chunks.chunks)
+        chunkRanges.emplace_back(chunk.firstIndex, chunk.count);
+    results.push_back(measure("terrain_chunks", size, std::vector<unsigned int>(chunked.begin(), chunked.end()),
+                              chunkRanges));
+
+    Water water;
+    auto waterIndices = water.initIndices(size);
+    results.push_back(measure("water_grid", size, *waterIndices, {{0, waterIndices->size()}}));
+    delete waterIndices;
+
+    std::vector<unsigned int> shuffled = gridIndices;
+    std::vector<size_t> order(shuffled.size() / 3);
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+    for (size_t i = 0; i < order.size(); i++)
+        for (int corner = 0; corner < 3; corner++)
+            shuffled[i * 3 + corner] = gridIndices[order[i] * 3 + corner];
+    results.push_back(measure("shuffled_grid", size, shuffled, {{0, shuffled.size()}}));
+    return results;
+}
+
+bool writeJson(const std::string &path, const std::vector<Result> &results) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "Failed to write " << path << std::endl;
+        return false;
+    }
+    out << "{\n  \"cache_sizes\": [" << CACHE_SIZES[0] << ", " << CACHE_SIZES[1] << "],\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"mesh\": \"" << r.mesh << "\", \"size\": " << r.size
+            << ", \"triangles\": " << r.triangles << ", \"acmr_before\": [" << r.before[0] << ", " << r.before[1]
+            << "], \"acmr_after\": [" << r.after[0] << ", " << r.after[1] << "], \"optimize_ms\": "
+            << r.optimizeMs << "}";
+    }
+    out << "\n  ]\n}\n";
+    return true;
+}
+
+int main(int argc, char **argv) {
+    std::vector<int> sizes{65, 200, 400, 1025};
+    std::string output = "vertex_cache_bench.json";
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--sizes") == 0 && hasValue) {
+            sizes = parseList(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            output = argv[++i];
+        } else {
+            std::cout << "usage: vertex_cache_bench [--sizes 65,200,...] [--output file.json]" << std::endl;
+            return 1;
+        }
+    }
+
+    worldSeed = 1;
+    std::vector<Result> results;
+    for (int size : sizes)
+        for (const auto &result : measureSize(size)) {
+            std::cout << result.mesh << " size " << result.size << ": ACMR(" << CACHE_SIZES[0] << ") "
+                      << result.before[0] << " -> " << result.after[0] << ", ACMR(" << CACHE_SIZES[1] << ") "
+                      << result.before[1] << " -> " << result.after[1] << ", " << result.optimizeMs << " ms"
+                      << std::endl;
+            results.push_back(result);
+        }
+
+    return writeJson(output, results) ? 0 : 1;
+}
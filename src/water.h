@@ -5,6 +5,12 @@
 #ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_WATER_H
 #define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_WATER_H
 
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "geometry_arena.h"
+
 class Water {
 public:
     Water();
@@ -48,27 +54,10 @@ public:
         return indices;
     }
 
-    unsigned int createVAO(std::vector<float> *vertices, std::vector<unsigned int> *indices) {
-        unsigned int VBO, VAO, EBO;
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-        glBindVertexArray(VAO);
-
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices->size() * sizeof(float), &vertices->at(0), GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices->size() * sizeof(unsigned int), &indices->at(0), GL_STATIC_DRAW);
-
-        // Position attributes
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *) 0);
-        glEnableVertexAttribArray(0);
-
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *) (3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-
-        return VAO;
+    // Copies the grid into arena, whose layout is position (3 floats), texture coordinates (2 floats).
+    GeometryRange upload(std::vector<float> *vertices, std::vector<unsigned int> *indices, GeometryArena &arena) {
+        return arena.add(vertices->data(), (GLsizei) (vertices->size() / 5), indices->data(),
+                         (GLsizei) indices->size());
     }
 
 private:
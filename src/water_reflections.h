@@ -0,0 +1,115 @@
+//
+// Planar reflection and refraction for the water. Each frame the scene above the water is drawn
+// mirrored about the water plane into one texture, and the scene below it into another, both at a
+// fraction of the output resolution (half or a quarter). Clip planes drop the geometry on the wrong
+// side; the water shader then samples both textures at its screen position.
+//
+
+#ifndef RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_WATER_REFLECTIONS_H
+#define RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_WATER_REFLECTIONS_H
+
+#include <algorithm>
+#include <iostream>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "gl_resources.h"
+
+class WaterReflections {
+public:
+    float scale;      // fraction of the output resolution per axis
+    float waterLevel; // world-space height of the water plane
+    GLTexture reflectionTexture;
+    GLTexture refractionTexture;
+
+    WaterReflections(float scale, float waterLevel) : scale(scale), waterLevel(waterLevel) {}
+
+    // Call once the context is current.
+    void init() {
+        reflectionFramebuffer.create();
+        refractionFramebuffer.create();
+        reflectionTexture.create();
+        refractionTexture.create();
+        // both passes run back to back, so they can share one depth buffer
+        depthBuffer.create();
+    }
+
+    // Sizes the targets for an output of width x height; cheap when nothing changed.
+    void resize(int width, int height) {
+        int scaledWidth = std::max(1, (int) (width * scale));
+        int scaledHeight = std::max(1, (int) (height * scale));
+        if (scaledWidth == targetWidth && scaledHeight == targetHeight)
+            return;
+        targetWidth = scaledWidth;
+        targetHeight = scaledHeight;
+
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, scaledWidth, scaledHeight);
+        depthBuffer.setBytes((long long) scaledWidth * scaledHeight * 4);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        createTarget(reflectionFramebuffer, reflectionTexture);
+        createTarget(refractionFramebuffer, refractionTexture);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void bindReflection() const {
+        bind(reflectionFramebuffer);
+    }
+
+    void bindRefraction() const {
+        bind(refractionFramebuffer);
+    }
+
+    // Mirrors world space about the water plane; the reflection pass uses view * mirror() as its view.
+    glm::mat4 mirror() const {
+        glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, waterLevel, 0.0f));
+        matrix = glm::scale(matrix, glm::vec3(1.0f, -1.0f, 1.0f));
+        return glm::translate(matrix, glm::vec3(0.0f, -waterLevel, 0.0f));
+    }
+
+    // Clip planes (xyz normal, w offset) keeping what is above or below the water. They reach a little
+    // past the surface so the waves don't uncover a gap at the shore.
+    glm::vec4 reflectionPlane() const {
+        return glm::vec4(0.0f, 1.0f, 0.0f, -waterLevel + CLIP_MARGIN);
+    }
+
+    glm::vec4 refractionPlane() const {
+        return glm::vec4(0.0f, -1.0f, 0.0f, waterLevel + CLIP_MARGIN);
+    }
+
+private:
+    static constexpr float CLIP_MARGIN = 0.5f;
+
+    GLFramebuffer reflectionFramebuffer;
+    GLFramebuffer refractionFramebuffer;
+    GLRenderbuffer depthBuffer;
+    int targetWidth = 0, targetHeight = 0;
+
+    void createTarget(unsigned int framebuffer, GLTexture &texture) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        // linear color like the scene target
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, targetWidth, targetHeight, 0, GL_RGB, GL_FLOAT, nullptr);
+        texture.setBytes((long long) targetWidth * targetHeight * 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Water reflection target is incomplete" << std::endl;
+    }
+
+    void bind(unsigned int framebuffer) const {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, targetWidth, targetHeight);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+};
+
+#endif //RAF_RG_PROJEKAT_VLADETAPUTNIKOVIC_WATER_REFLECTIONS_H